@@ -11,6 +11,26 @@ Animation2D::Animation2D(const char* file, bool alpha, int columns, int rows, fl
     : width(0), height(0), internalFormat(GL_RGB), imageFormat(GL_RGB), wrapS(GL_REPEAT),
     wrapT(GL_REPEAT), filterMin(filter), filterMax(filter)
 {
+    this->columns = columns;
+    this->rows = rows;
+    this->speed = speed;
+    this->rowsToCols = rowsToCols;
+    this->loop = loop;
+
+    // See texture_2D.h.
+    if (Texture2D::headless)
+    {
+        int imageWidth;
+        int imageHeight;
+        int nrChannels;
+        stbi_info(file, &imageWidth, &imageHeight, &nrChannels);
+
+        this->ID = Texture2D::NextHeadlessID();
+        this->width = imageWidth;
+        this->height = imageHeight;
+        return;
+    }
+
     glGenTextures(1, &this->ID);
 
     if (alpha)
@@ -29,12 +49,6 @@ Animation2D::Animation2D(const char* file, bool alpha, int columns, int rows, fl
     this->width = imageWidth;
     this->height = imageHeight;
 
-    this->columns = columns;
-    this->rows = rows;
-    this->speed = speed;
-    this->rowsToCols = rowsToCols;
-    this->loop = loop;
-
     // Create
     glBindTexture(GL_TEXTURE_2D, this->ID);
     glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, imageWidth, imageHeight, 0, this->imageFormat, GL_UNSIGNED_BYTE, data);
@@ -55,6 +69,12 @@ Animation2D::Animation2D()
     : width(1), height(1), internalFormat(GL_RGB), imageFormat(GL_RGB), wrapS(GL_REPEAT),
     wrapT(GL_REPEAT), filterMin(GL_LINEAR), filterMax(GL_LINEAR)
 {
+    if (Texture2D::headless)
+    {
+        this->ID = Texture2D::NextHeadlessID();
+        return;
+    }
+
     glGenTextures(1, &this->ID);
 
     constexpr unsigned char data[] = { UCHAR_MAX, UCHAR_MAX, UCHAR_MAX };
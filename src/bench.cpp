@@ -0,0 +1,753 @@
+// bench.cpp
+//
+
+// This is the benchmark: it builds a synthetic world out of the same prefabs and components the game uses,
+// runs it headless (see main.cpp) for a fixed number of ticks, and writes out how long each system took,
+// how fast entities can be spawned and destroyed, and how much memory the whole thing peaked at, as JSON.
+// The idea is to run it on every commit with the same arguments and compare the numbers.
+
+// moonlight-bench [--platforms N] [--bodies N] [--bullets N] [--emitters N] [--ticks N] [--churn N] [--seed N] [--serial] [--out file] [--trace file]
+//                 [--broadphase grid|tree|sap|brute] [--compare N] [--narrowphase N]
+// --trace records the ticks with the profiler (see profiler.h) and writes them out as a Chrome trace.
+// --broadphase picks the collider system's broadphase for the run (see broadphase.h).
+// --compare runs every kind of broadphase over the same colliders (taken from the world once the ticks are done) for N steps,
+// and reports how long each took to build, update, query and find pairs; their candidate and pair counts should all be the same.
+// --narrowphase pushes N random pairs through the narrowphase one at a time (the way RayOverlapRect() is called) and in batches
+// (see narrowphase.h), and reports how many pairs a second each manages and how many pairs they disagreed on (which should be none).
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "game.h"
+#include "entity.h"
+#include "particleengine.h"
+#include "ecs.h"
+#include "system.h"
+#include "component.h"
+#include "prefab.h"
+#include "input.h"
+#include "profiler.h"
+#include "narrowphase.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+Game Game::main;
+ECS ECS::main;
+ParticleEngine ParticleEngine::main;
+BodyStream BodyStream::main;
+Profiler Profiler::main;
+
+struct BenchConfig
+{
+    int platforms = 500;
+    int bodies = 2000;
+    int bullets = 500;
+    int emitters = 50;
+    int ticks = 2000;
+
+    // How many bullets are spawned and destroyed at once when measuring throughput, and how many times.
+    int churn = 5000;
+    int churnRounds = 10;
+
+    unsigned int seed = 1;
+    bool serial = false;
+    std::string out;
+    std::string trace;
+
+    BroadphaseType broadphase = BroadphaseType::grid;
+    int compare = 25;
+
+    int narrowphase = 1 << 16;
+    int narrowphaseRounds = 100;
+};
+
+struct Summary
+{
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+static Summary Summarize(std::vector<float> samples)
+{
+    Summary s;
+
+    if (samples.size() == 0)
+    {
+        return s;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    double total = 0.0;
+
+    for (int i = 0; i < samples.size(); i++)
+    {
+        total += samples[i];
+    }
+
+    s.mean = total / samples.size();
+    s.p50 = samples[(samples.size() - 1) / 2];
+    s.p99 = samples[(size_t)((samples.size() - 1) * 0.99)];
+    s.max = samples.back();
+    return s;
+}
+
+static long PeakMemoryKB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return (long)(counters.PeakWorkingSetSize / 1024);
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#endif
+}
+
+static float Random(float min, float max)
+{
+    return min + static_cast<float>(rand()) / RAND_MAX * (max - min);
+}
+
+static double Since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool ParseArguments(int argc, char* argv[], BenchConfig& config)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--serial")
+        {
+            config.serial = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing a value for " + arg + "\n";
+            return false;
+        }
+
+        std::string value = argv[++i];
+
+        if (arg == "--platforms") config.platforms = std::stoi(value);
+        else if (arg == "--bodies") config.bodies = std::stoi(value);
+        else if (arg == "--bullets") config.bullets = std::stoi(value);
+        else if (arg == "--emitters") config.emitters = std::stoi(value);
+        else if (arg == "--ticks") config.ticks = std::stoi(value);
+        else if (arg == "--churn") config.churn = std::stoi(value);
+        else if (arg == "--seed") config.seed = std::stoul(value);
+        else if (arg == "--out") config.out = value;
+        else if (arg == "--trace") config.trace = value;
+        else if (arg == "--compare") config.compare = std::stoi(value);
+        else if (arg == "--narrowphase") config.narrowphase = std::stoi(value);
+        else if (arg == "--broadphase" && value == "grid") config.broadphase = BroadphaseType::grid;
+        else if (arg == "--broadphase" && value == "tree") config.broadphase = BroadphaseType::tree;
+        else if (arg == "--broadphase" && value == "sap") config.broadphase = BroadphaseType::sweepAndPrune;
+        else if (arg == "--broadphase" && value == "brute") config.broadphase = BroadphaseType::bruteForce;
+        else
+        {
+            std::cerr << "Unknown argument " + arg + "\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#pragma region World Building
+
+// The world is a square of this size, and the camera sits in the middle of it (so the render systems have something to cull).
+constexpr float worldSize = 5000.0f;
+
+static void SpawnPlatforms(int count)
+{
+    // These are the same as the random platforms the starting level is made of.
+    std::vector<PrefabInstance> platforms(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        platforms[i].size = glm::vec2(rand() % 1000 + 300, rand() % 1000 + 300);
+        platforms[i].position = glm::vec3(rand() % (int)worldSize, rand() % (int)worldSize, 0);
+    }
+
+    ECS::main.GetPrefab("floor")->Instantiate(count, platforms.data());
+}
+
+static void SpawnBodies(int count)
+{
+    Texture2D* tex = Game::main.textureMap["blank"];
+    Texture2D* map = Game::main.textureMap["base_map"];
+
+    for (int i = 0; i < count; i++)
+    {
+        Entity* body = ECS::main.CreateEntity(0, "body");
+        ECS::main.AddComponent<PositionComponent>(body, true, false, Random(0.0f, worldSize), Random(0.0f, worldSize), 0.0f, 0.0f);
+        PositionComponent* pos = body->Get<PositionComponent>();
+
+        ECS::main.AddComponent<PhysicsComponent>(body, true, pos, Random(-200.0f, 200.0f), Random(-200.0f, 200.0f), 0.0f, 0.1f, 1.0f);
+        ECS::main.AddComponent<ColliderComponent>(body, true, pos, false, false, false, false, false, false, false, EntityClass::object, 1.0f, 0.5f, 1.0f, 20.0f, 20.0f, 0.0f, 0.0f);
+        ECS::main.AddComponent<StaticSpriteComponent>(body, true, pos, 20.0f, 20.0f, 1.0f, 1.0f, tex, map, false, false, false, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    }
+}
+
+static void SpawnBullets(int count)
+{
+    std::vector<PrefabInstance> bullets(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        bullets[i].position = glm::vec3(Random(0.0f, worldSize), Random(0.0f, worldSize), 0.0f);
+        bullets[i].velocity = glm::vec2(Random(-1000.0f, 1000.0f), Random(-1000.0f, 1000.0f));
+    }
+
+    ECS::main.GetPrefab("aether bullet")->Instantiate(count, bullets.data());
+}
+
+static void SpawnEmitters(int count)
+{
+    // Emitters only emit while they're on screen, so they're scattered around the camera.
+    const float halfWidth = Game::main.windowWidth * Game::main.zoom * 0.5f;
+    const float halfHeight = Game::main.windowHeight * Game::main.zoom * 0.5f;
+
+    for (int i = 0; i < count; i++)
+    {
+        Entity* emitter = ECS::main.CreateEntity(0, "emitter");
+        float x = Game::main.camX + Random(-halfWidth, halfWidth);
+        float y = Game::main.camY + Random(-halfHeight, halfHeight);
+
+        ECS::main.AddComponent<PositionComponent>(emitter, true, true, x, y, 0.0f, 0.0f);
+        ECS::main.AddComponent<ParticleComponent>(emitter, true, 0.05f, 0.0f, 0.0f, 2, Element::aether, 0.5f, 1.5f);
+    }
+}
+
+#pragma endregion
+
+#pragma region Broadphase Comparison
+
+static const char* BroadphaseName(BroadphaseType type)
+{
+    return (type == BroadphaseType::tree) ? "tree" : (type == BroadphaseType::sweepAndPrune) ? "sap" : (type == BroadphaseType::bruteForce) ? "brute" : "grid";
+}
+
+struct BroadphaseResult
+{
+    BroadphaseType type;
+    double buildMs = 0.0;
+    double updateMs = 0.0;
+    double queryMs = 0.0;
+    double raycastMs = 0.0;
+    double pairsMs = 0.0;
+    long candidates = 0;
+    long rayHits = 0;
+    long pairs = 0;
+    int height = 0;
+
+    // Sweep and prune only: how many pairs started and stopped overlapping.
+    long began = 0;
+    long ended = 0;
+};
+
+// A snapshot of the world's colliders: where they are, and how far they go each step.
+struct BroadphaseScene
+{
+    std::vector<ColliderComponent*> colliders;
+    std::vector<AABB> boxes;
+    std::vector<glm::vec2> steps;
+    std::vector<bool> stat;
+    std::vector<uint32_t> layers;
+    std::vector<uint32_t> masks;
+};
+
+static BroadphaseScene SnapshotColliders()
+{
+    BroadphaseScene scene;
+
+    auto& rows = ECS::main.View<ColliderComponent, PhysicsComponent>().rows[0];
+
+    for (int i = 0; i < rows.size(); i++)
+    {
+        auto [c, phys] = rows[i];
+
+        if (!c->active)
+        {
+            continue;
+        }
+
+        float x = c->pos->x + c->offsetX;
+        float y = c->pos->y + c->offsetY;
+
+        scene.colliders.push_back(c);
+        scene.boxes.push_back({ x - c->width / 2.0f, y - c->height / 2.0f, x + c->width / 2.0f, y + c->height / 2.0f });
+        scene.steps.push_back(glm::vec2(phys->velocityX, phys->velocityY) * ECS::main.fixedStep);
+        scene.stat.push_back(c->pos->stat);
+        scene.layers.push_back(c->layer);
+        scene.masks.push_back(c->mask);
+    }
+
+    return scene;
+}
+
+static BroadphaseResult CompareBroadphase(BroadphaseType type, const BroadphaseScene& scene, int steps)
+{
+    BroadphaseResult result;
+    result.type = type;
+
+    std::vector<AABB> boxes = scene.boxes;
+    std::vector<int> proxies(boxes.size());
+    std::vector<ColliderComponent*> candidates;
+    std::vector<RayHit> hits;
+    std::vector<ColliderPair> pairs;
+
+    auto buildStart = std::chrono::steady_clock::now();
+    Broadphase* broadphase = CreateBroadphase(type);
+    SweepAndPrune* sap = (type == BroadphaseType::sweepAndPrune) ? (SweepAndPrune*)broadphase : nullptr;
+
+    for (int i = 0; i < boxes.size(); i++)
+    {
+        proxies[i] = broadphase->CreateProxy(scene.colliders[i], boxes[i], scene.stat[i], scene.layers[i], scene.masks[i]);
+    }
+
+    // Sweep and prune only puts new proxies in when something asks, so the build has to include that.
+    if (sap != nullptr)
+    {
+        sap->Flush();
+    }
+
+    result.buildMs = Since(buildStart);
+
+    if (sap != nullptr)
+    {
+        sap->recordEvents = true;
+    }
+
+    for (int step = 0; step < steps; step++)
+    {
+        auto updateStart = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < boxes.size(); i++)
+        {
+            if (scene.stat[i])
+            {
+                continue;
+            }
+
+            AABB& box = boxes[i];
+            box = { box.minX + scene.steps[i].x, box.minY + scene.steps[i].y, box.maxX + scene.steps[i].x, box.maxY + scene.steps[i].y };
+            broadphase->MoveProxy(proxies[i], box);
+        }
+
+        result.updateMs += Since(updateStart);
+
+        if (sap != nullptr)
+        {
+            result.began += sap->began.size();
+            result.ended += sap->ended.size();
+            sap->ClearEvents();
+        }
+
+        // Every moving collider asks what's around it, the way the collider system does.
+        auto queryStart = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < boxes.size(); i++)
+        {
+            if (!scene.stat[i])
+            {
+                candidates.clear();
+                broadphase->Overlapping(proxies[i], candidates);
+                result.candidates += candidates.size();
+            }
+        }
+
+        result.queryMs += Since(queryStart);
+
+        // A handful of long rays across the world, the way line of sight checks would.
+        auto raycastStart = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < 16; i++)
+        {
+            float y = worldSize * (i + 0.5f) / 16.0f;
+
+            hits.clear();
+            broadphase->Raycast(0.0f, y, worldSize, worldSize - y, hits);
+            result.rayHits += hits.size();
+        }
+
+        result.raycastMs += Since(raycastStart);
+
+        auto pairsStart = std::chrono::steady_clock::now();
+
+        pairs.clear();
+        broadphase->Pairs(pairs);
+        result.pairs += pairs.size();
+
+        result.pairsMs += Since(pairsStart);
+    }
+
+    if (type == BroadphaseType::tree)
+    {
+        result.height = ((AABBTree*)broadphase)->Height();
+    }
+
+    delete broadphase;
+    return result;
+}
+
+#pragma endregion
+
+#pragma region Narrowphase
+
+struct NarrowphaseResult
+{
+    double singleMs = 0.0;
+    double scalarMs = 0.0;
+    double wideMs = 0.0;
+    long hits = 0;
+    long mismatches = 0;
+};
+
+static NarrowphaseResult BenchNarrowphase(int count, int rounds)
+{
+    NarrowphaseResult result;
+    SweptPairs pairs;
+
+    // Boxes about the size of ours, moving about as fast, with some of them standing still on one axis or both
+    // (which is where the one-at-a-time version's NaN checks come in).
+    for (int i = 0; i < count; i++)
+    {
+        glm::vec2 origin = glm::vec2(Random(0.0f, 1000.0f), Random(0.0f, 1000.0f));
+        glm::vec2 dir = glm::vec2((rand() % 10 == 0) ? 0.0f : Random(-50.0f, 50.0f), (rand() % 10 == 0) ? 0.0f : Random(-50.0f, 50.0f));
+        glm::vec2 center = origin + glm::vec2(Random(-100.0f, 100.0f), Random(-100.0f, 100.0f));
+
+        pairs.Add(origin, dir, center, Random(10.0f, 200.0f), Random(10.0f, 200.0f));
+    }
+
+    SweptPairs scalar = pairs;
+    SweptAABB(scalar);
+
+    long hits = 0;
+
+    auto singleStart = std::chrono::steady_clock::now();
+
+    for (int round = 0; round < rounds; round++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            glm::vec2 contactPoint;
+            glm::vec2 contactNormal;
+            float time;
+
+            if (RayOverlapRect(glm::vec2(pairs.originX[i], pairs.originY[i]), glm::vec2(pairs.dirX[i], pairs.dirY[i]), glm::vec2(pairs.centerX[i], pairs.centerY[i]),
+                pairs.width[i], pairs.height[i], contactPoint, contactNormal, time) && time < 1.0f && time >= 0.0f)
+            {
+                hits++;
+            }
+        }
+    }
+
+    result.singleMs = Since(singleStart);
+
+    auto scalarStart = std::chrono::steady_clock::now();
+
+    for (int round = 0; round < rounds; round++)
+    {
+        SweptAABBScalar(scalar, 0, count);
+    }
+
+    result.scalarMs = Since(scalarStart);
+
+    auto wideStart = std::chrono::steady_clock::now();
+
+    for (int round = 0; round < rounds; round++)
+    {
+        SweptAABB(pairs);
+    }
+
+    result.wideMs = Since(wideStart);
+
+    for (int i = 0; i < count; i++)
+    {
+        bool same = pairs.hit[i] == scalar.hit[i];
+
+        if (same && pairs.hit[i])
+        {
+            same = pairs.time[i] == scalar.time[i] && pairs.normalX[i] == scalar.normalX[i] && pairs.normalY[i] == scalar.normalY[i]
+                && pairs.contactX[i] == scalar.contactX[i] && pairs.contactY[i] == scalar.contactY[i];
+        }
+
+        result.hits += pairs.hit[i];
+        result.mismatches += !same;
+    }
+
+    // The one-at-a-time loop has to agree too, or there's no point comparing against it.
+    result.mismatches += std::abs(hits / rounds - result.hits);
+
+    return result;
+}
+
+#pragma endregion
+
+int main(int argc, char* argv[])
+{
+    BenchConfig config;
+
+    if (!ParseArguments(argc, argv, config))
+    {
+        return 1;
+    }
+
+    srand(config.seed);
+
+    #pragma region Headless Setup
+    // This is the same as a headless run of the game (see main.cpp), except that nothing's loaded from the assets:
+    // the benchmark only needs the textures' sizes, so every texture it uses is just a white one.
+    Texture2D::headless = true;
+
+    ScriptedInput input;
+    Game::main.input = &input;
+
+    Renderer renderer;
+    Game::main.renderer = &renderer;
+
+    const char* textures[] = { "bullet", "aether_bullet", "blank", "base_map" };
+
+    for (const char* name : textures)
+    {
+        Texture2D* tex = Texture2D::whiteTexture();
+        tex->width = 16;
+        tex->height = 16;
+        renderer.textureIDs.push_back(tex->ID);
+        Game::main.textureMap.emplace(name, tex);
+    }
+
+    Game::main.camX = worldSize / 2.0f;
+    Game::main.camY = worldSize / 2.0f;
+    Game::main.UpdateOrtho();
+    Game::main.UpdateView();
+
+    ECS::main.loadLevel = false;
+    ECS::main.Init();
+    ECS::main.scheduler.parallel = !config.serial;
+    ((ColliderSystem*)ECS::main.blocksByID[colliderComponentID]->system)->SetBroadphase(0, config.broadphase);
+    ParticleEngine::main.Init(0.05f);
+
+    // The first update only defines the prefabs (there's no level to load).
+    ECS::main.Update(0.0f);
+    #pragma endregion
+
+    #pragma region World Setup
+    auto setupStart = std::chrono::steady_clock::now();
+
+    SpawnPlatforms(config.platforms);
+    SpawnBodies(config.bodies);
+    SpawnBullets(config.bullets);
+    SpawnEmitters(config.emitters);
+
+    double setupMs = Since(setupStart);
+    int setupEntities = ECS::main.registry.entities.size();
+    #pragma endregion
+
+    #pragma region Ticks
+    // Every tick is exactly one fixed step of the simulation and one rendered frame.
+    std::vector<ComponentBlock*>& blocks = ECS::main.componentBlocks;
+    std::vector<std::vector<float>> systemSamples(blocks.size());
+    std::vector<float> tickSamples;
+    tickSamples.reserve(config.ticks);
+
+    Prefab* bullet = ECS::main.GetPrefab("aether bullet");
+    int respawned = 0;
+
+    Profiler::main.enabled = (config.trace != "");
+
+    auto runStart = std::chrono::steady_clock::now();
+
+    for (int tick = 0; tick < config.ticks; tick++)
+    {
+        ProfileScope frame("frame");
+        auto tickStart = std::chrono::steady_clock::now();
+
+        Game::main.UpdateView();
+        ECS::main.Update(ECS::main.fixedStep);
+        ParticleEngine::main.Update(ECS::main.fixedStep);
+        renderer.resetBuffers();
+
+        tickSamples.push_back((float)Since(tickStart));
+
+        for (int i = 0; i < blocks.size(); i++)
+        {
+            systemSamples[i].push_back(blocks[i]->system->lastMs);
+        }
+
+        // Bullets die when they hit something (or run out of time), so they're topped back up the way a fight would.
+        int missing = config.bullets - bullet->stats.live;
+
+        if (missing > 0)
+        {
+            SpawnBullets(missing);
+            respawned += missing;
+        }
+    }
+
+    double runMs = Since(runStart);
+
+    if (Profiler::main.enabled)
+    {
+        Profiler::main.enabled = false;
+        Profiler::main.WriteTrace(config.trace);
+    }
+    int liveEntities = ECS::main.registry.entities.size();
+    #pragma endregion
+
+    #pragma region Broadphases
+    std::vector<BroadphaseResult> broadphases;
+
+    if (config.compare > 0)
+    {
+        BroadphaseScene scene = SnapshotColliders();
+
+        for (BroadphaseType type : { BroadphaseType::bruteForce, BroadphaseType::grid, BroadphaseType::tree, BroadphaseType::sweepAndPrune })
+        {
+            broadphases.push_back(CompareBroadphase(type, scene, config.compare));
+        }
+    }
+    #pragma endregion
+
+    #pragma region Narrowphase
+    NarrowphaseResult narrowphase;
+
+    if (config.narrowphase > 0)
+    {
+        narrowphase = BenchNarrowphase(config.narrowphase, config.narrowphaseRounds);
+    }
+    #pragma endregion
+
+    #pragma region Churn
+    // Spawning and destroying a lot of bullets at once, outside of any tick, is how fast the entity bookkeeping itself is.
+    double spawnMs = 0.0;
+    double destroyMs = 0.0;
+    int churned = 0;
+
+    for (int round = 0; round < config.churnRounds; round++)
+    {
+        auto spawnStart = std::chrono::steady_clock::now();
+        SpawnBullets(config.churn);
+        spawnMs += Since(spawnStart);
+
+        std::vector<Entity*> doomed = ECS::main.registry.FindAll(bullet->name);
+
+        auto destroyStart = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < doomed.size(); i++)
+        {
+            ECS::main.AddDeadEntity(doomed[i]);
+        }
+
+        ECS::main.PurgeDeadEntities();
+        destroyMs += Since(destroyStart);
+
+        churned += doomed.size();
+    }
+    #pragma endregion
+
+    #pragma region Report
+    std::ofstream file;
+
+    if (config.out != "")
+    {
+        file.open(config.out);
+
+        if (!file)
+        {
+            std::cerr << "Couldn't open " + config.out + "\n";
+            return 1;
+        }
+    }
+
+    std::ostream& json = (config.out != "") ? file : std::cout;
+    json.setf(std::ios::fixed);
+    json.precision(4);
+
+    auto summary = [&json](const Summary& s)
+    {
+        json << "\"mean_ms\": " << s.mean << ", \"p50_ms\": " << s.p50 << ", \"p99_ms\": " << s.p99 << ", \"max_ms\": " << s.max;
+    };
+
+    json << "{\n";
+    json << "  \"config\": { \"platforms\": " << config.platforms << ", \"bodies\": " << config.bodies << ", \"bullets\": " << config.bullets
+        << ", \"emitters\": " << config.emitters << ", \"ticks\": " << config.ticks << ", \"churn\": " << config.churn
+        << ", \"seed\": " << config.seed << ", \"threads\": " << ECS::main.scheduler.stats.threads
+        << ", \"broadphase\": \"" << BroadphaseName(config.broadphase) << "\", \"compare\": " << config.compare << " },\n";
+    json << "  \"setup\": { \"ms\": " << setupMs << ", \"entities\": " << setupEntities << " },\n";
+    json << "  \"run\": { \"ms\": " << runMs << ", \"ticks_per_second\": " << (config.ticks / (runMs / 1000.0))
+        << ", \"live_entities\": " << liveEntities << ", \"bullets_respawned\": " << respawned << " },\n";
+
+    json << "  \"tick\": { ";
+    summary(Summarize(tickSamples));
+    json << " },\n";
+
+    json << "  \"systems\": [\n";
+
+    for (int i = 0; i < blocks.size(); i++)
+    {
+        json << "    { \"name\": \"" << blocks[i]->system->name << "\", \"phase\": \"" << (blocks[i]->system->render ? "render" : "simulation") << "\", ";
+        summary(Summarize(systemSamples[i]));
+        json << " }" << ((i + 1 < blocks.size()) ? ",\n" : "\n");
+    }
+
+    json << "  ],\n";
+
+    json << "  \"broadphase\": [\n";
+
+    for (int i = 0; i < broadphases.size(); i++)
+    {
+        const BroadphaseResult& b = broadphases[i];
+
+        json << "    { \"type\": \"" << BroadphaseName(b.type) << "\", \"build_ms\": " << b.buildMs << ", \"update_ms\": " << b.updateMs
+            << ", \"query_ms\": " << b.queryMs << ", \"raycast_ms\": " << b.raycastMs << ", \"pairs_ms\": " << b.pairsMs
+            << ", \"candidates\": " << b.candidates << ", \"ray_hits\": " << b.rayHits << ", \"pairs\": " << b.pairs << ", \"height\": " << b.height
+            << ", \"began\": " << b.began << ", \"ended\": " << b.ended
+            << " }" << ((i + 1 < broadphases.size()) ? ",\n" : "\n");
+    }
+
+    json << "  ],\n";
+
+    // With --narrowphase 0 nothing was timed, so the rates are left at zero rather than dividing by it.
+    double narrowphasePairs = (config.narrowphase > 0) ? (double)config.narrowphase * config.narrowphaseRounds : 0.0;
+    auto perSecond = [&](double ms) { return (ms > 0.0) ? narrowphasePairs / (ms / 1000.0) : 0.0; };
+
+    json << "  \"narrowphase\": { \"kernel\": \"" << SweptAABBKernel() << "\", \"pairs\": " << config.narrowphase << ", \"hits\": " << narrowphase.hits
+        << ", \"single_pairs_per_second\": " << perSecond(narrowphase.singleMs)
+        << ", \"scalar_pairs_per_second\": " << perSecond(narrowphase.scalarMs)
+        << ", \"batched_pairs_per_second\": " << perSecond(narrowphase.wideMs)
+        << ", \"mismatches\": " << narrowphase.mismatches << " },\n";
+
+    json << "  \"spawn\": { \"entities\": " << config.churn * config.churnRounds << ", \"ms\": " << spawnMs
+        << ", \"per_second\": " << (config.churn * config.churnRounds / (spawnMs / 1000.0))
+        << ", \"recycled\": " << bullet->stats.hits << ", \"created\": " << bullet->stats.misses << " },\n";
+    json << "  \"destroy\": { \"entities\": " << churned << ", \"ms\": " << destroyMs << ", \"per_second\": " << (churned / (destroyMs / 1000.0)) << " },\n";
+    json << "  \"peak_memory_kb\": " << PeakMemoryKB() << "\n";
+    json << "}\n";
+    #pragma endregion
+
+    return 0;
+}
@@ -0,0 +1,1490 @@
+// This holds the logic for the collider system's broadphases.
+// The grid itself is just a map from cell coordinates to the proxies overlapping that cell;
+// each proxy remembers which cells it was put in so that we only touch the map when
+// a collider actually crosses into a different set of cells.
+// The tree, sweep and prune, and the brute force broadphase are further down.
+
+#include "broadphase.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+bool RayOverlaps(const AABB& box, float fromX, float fromY, float dX, float dY, float& fraction)
+{
+	// This is the usual slab test: the segment's inside the box wherever it's between both pairs of edges at once.
+	float tMin = 0.0f;
+	float tMax = 1.0f;
+
+	const float from[2] = { fromX, fromY };
+	const float d[2] = { dX, dY };
+	const float minEdge[2] = { box.minX, box.minY };
+	const float maxEdge[2] = { box.maxX, box.maxY };
+
+	for (int axis = 0; axis < 2; axis++)
+	{
+		if (std::abs(d[axis]) < 1e-8f)
+		{
+			// The segment's parallel to these edges, so it's either between them the whole way or never.
+			if (from[axis] < minEdge[axis] || from[axis] > maxEdge[axis])
+			{
+				return false;
+			}
+
+			continue;
+		}
+
+		float inverse = 1.0f / d[axis];
+		float t1 = (minEdge[axis] - from[axis]) * inverse;
+		float t2 = (maxEdge[axis] - from[axis]) * inverse;
+
+		tMin = std::max(tMin, std::min(t1, t2));
+		tMax = std::min(tMax, std::max(t1, t2));
+
+		if (tMin > tMax)
+		{
+			return false;
+		}
+	}
+
+	fraction = tMin;
+	return true;
+}
+
+Broadphase* CreateBroadphase(BroadphaseType type)
+{
+	if (type == BroadphaseType::tree)
+	{
+		return new AABBTree(8.0f);
+	}
+	else if (type == BroadphaseType::sweepAndPrune)
+	{
+		return new SweepAndPrune();
+	}
+	else if (type == BroadphaseType::bruteForce)
+	{
+		return new BruteForceBroadphase();
+	}
+
+	return new SpatialHash(128.0f);
+}
+
+#pragma region Spatial Hash
+
+int SpatialHash::CellCoord(float v)
+{
+	return (int)std::floor(v / cellSize);
+}
+
+int64_t SpatialHash::Key(int x, int y)
+{
+	return ((int64_t)x << 32) | (uint32_t)y;
+}
+
+void SpatialHash::Insert(int proxy)
+{
+	Proxy& p = proxies[proxy];
+
+	for (int x = p.cellMinX; x <= p.cellMaxX; x++)
+	{
+		for (int y = p.cellMinY; y <= p.cellMaxY; y++)
+		{
+			cells[Key(x, y)].push_back(proxy);
+		}
+	}
+}
+
+void SpatialHash::Remove(int proxy)
+{
+	Proxy& p = proxies[proxy];
+
+	for (int x = p.cellMinX; x <= p.cellMaxX; x++)
+	{
+		for (int y = p.cellMinY; y <= p.cellMaxY; y++)
+		{
+			auto cell = cells.find(Key(x, y));
+
+			if (cell != cells.end())
+			{
+				std::vector<int>& c = cell->second;
+				auto it = std::find(c.begin(), c.end(), proxy);
+
+				if (it != c.end())
+				{
+					*it = c.back();
+					c.pop_back();
+				}
+
+				if (c.empty())
+				{
+					cells.erase(cell);
+				}
+			}
+		}
+	}
+}
+
+int SpatialHash::CreateProxy(ColliderComponent* collider, const AABB& box, bool stat, uint32_t layer, uint32_t mask)
+{
+	int proxy;
+
+	if (freeProxies.size() > 0)
+	{
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else
+	{
+		proxy = proxies.size();
+		proxies.push_back(Proxy());
+	}
+
+	Proxy& p = proxies[proxy];
+	p.collider = collider;
+	p.box = box;
+	p.cellMinX = CellCoord(box.minX);
+	p.cellMinY = CellCoord(box.minY);
+	p.cellMaxX = CellCoord(box.maxX);
+	p.cellMaxY = CellCoord(box.maxY);
+	p.queryStamp = 0;
+	p.stat = stat;
+	p.alive = true;
+	p.layer = layer;
+	p.mask = mask;
+
+	Insert(proxy);
+
+	return proxy;
+}
+
+void SpatialHash::MoveProxy(int proxy, const AABB& box)
+{
+	Proxy& p = proxies[proxy];
+	p.box = box;
+
+	int minX = CellCoord(box.minX);
+	int minY = CellCoord(box.minY);
+	int maxX = CellCoord(box.maxX);
+	int maxY = CellCoord(box.maxY);
+
+	if (minX != p.cellMinX || minY != p.cellMinY || maxX != p.cellMaxX || maxY != p.cellMaxY)
+	{
+		Remove(proxy);
+
+		p.cellMinX = minX;
+		p.cellMinY = minY;
+		p.cellMaxX = maxX;
+		p.cellMaxY = maxY;
+
+		Insert(proxy);
+	}
+}
+
+void SpatialHash::DestroyProxy(int proxy)
+{
+	Remove(proxy);
+
+	proxies[proxy].alive = false;
+	proxies[proxy].collider = nullptr;
+	freeProxies.push_back(proxy);
+}
+
+void SpatialHash::SetFilter(int proxy, uint32_t layer, uint32_t mask)
+{
+	proxies[proxy].layer = layer;
+	proxies[proxy].mask = mask;
+}
+
+const AABB& SpatialHash::GetBox(int proxy)
+{
+	return proxies[proxy].box;
+}
+
+bool SpatialHash::IsStatic(int proxy)
+{
+	return proxies[proxy].stat;
+}
+
+void SpatialHash::Query(const AABB& box, std::vector<ColliderComponent*>& out)
+{
+	// The stamp lets us skip colliders we've already seen during this query
+	// without having to sort and unique the results afterwards.
+	queryStamp++;
+
+	int minX = CellCoord(box.minX);
+	int minY = CellCoord(box.minY);
+	int maxX = CellCoord(box.maxX);
+	int maxY = CellCoord(box.maxY);
+
+	for (int x = minX; x <= maxX; x++)
+	{
+		for (int y = minY; y <= maxY; y++)
+		{
+			auto cell = cells.find(Key(x, y));
+
+			if (cell == cells.end())
+			{
+				continue;
+			}
+
+			for (int proxy : cell->second)
+			{
+				Proxy& p = proxies[proxy];
+
+				if (p.queryStamp != queryStamp)
+				{
+					p.queryStamp = queryStamp;
+
+					if (Overlaps(p.box, box))
+					{
+						out.push_back(p.collider);
+					}
+				}
+			}
+		}
+	}
+}
+
+void SpatialHash::Overlapping(int proxy, std::vector<ColliderComponent*>& out)
+{
+	Proxy& p = proxies[proxy];
+
+	// The proxy's own stamp is set first so it never turns up in its own results.
+	queryStamp++;
+	p.queryStamp = queryStamp;
+
+	for (int x = p.cellMinX; x <= p.cellMaxX; x++)
+	{
+		for (int y = p.cellMinY; y <= p.cellMaxY; y++)
+		{
+			auto cell = cells.find(Key(x, y));
+
+			if (cell == cells.end())
+			{
+				continue;
+			}
+
+			for (int other : cell->second)
+			{
+				Proxy& q = proxies[other];
+
+				if (q.queryStamp != queryStamp)
+				{
+					q.queryStamp = queryStamp;
+
+					if (Interacts(p.layer, p.mask, q.layer, q.mask) && Overlaps(p.box, q.box))
+					{
+						out.push_back(q.collider);
+					}
+				}
+			}
+		}
+	}
+}
+
+void SpatialHash::Raycast(float fromX, float fromY, float toX, float toY, std::vector<RayHit>& out)
+{
+	queryStamp++;
+
+	float dX = toX - fromX;
+	float dY = toY - fromY;
+
+	// We walk the cells the segment passes through in order (Amanatides and Woo's traversal),
+	// checking whatever's in each one we haven't already seen.
+	int x = CellCoord(fromX);
+	int y = CellCoord(fromY);
+	int endX = CellCoord(toX);
+	int endY = CellCoord(toY);
+
+	int stepX = (dX > 0.0f) ? 1 : -1;
+	int stepY = (dY > 0.0f) ? 1 : -1;
+
+	const float infinity = std::numeric_limits<float>::infinity();
+	float nextX = (dX != 0.0f) ? (((x + (stepX > 0 ? 1 : 0)) * cellSize) - fromX) / dX : infinity;
+	float nextY = (dY != 0.0f) ? (((y + (stepY > 0 ? 1 : 0)) * cellSize) - fromY) / dY : infinity;
+	float deltaX = (dX != 0.0f) ? cellSize / std::abs(dX) : infinity;
+	float deltaY = (dY != 0.0f) ? cellSize / std::abs(dY) : infinity;
+
+	int cellsLeft = std::abs(endX - x) + std::abs(endY - y) + 1;
+
+	for (; cellsLeft > 0; cellsLeft--)
+	{
+		auto cell = cells.find(Key(x, y));
+
+		if (cell != cells.end())
+		{
+			for (int proxy : cell->second)
+			{
+				Proxy& p = proxies[proxy];
+				float fraction;
+
+				if (p.queryStamp != queryStamp)
+				{
+					p.queryStamp = queryStamp;
+
+					if (RayOverlaps(p.box, fromX, fromY, dX, dY, fraction))
+					{
+						out.push_back({ p.collider, fraction });
+					}
+				}
+			}
+		}
+
+		if (nextX < nextY)
+		{
+			x += stepX;
+			nextX += deltaX;
+		}
+		else
+		{
+			y += stepY;
+			nextY += deltaY;
+		}
+	}
+}
+
+void SpatialHash::Pairs(std::vector<ColliderPair>& out)
+{
+	// Every moving proxy looks at what shares its cells. A pair of moving proxies would be found from both ends,
+	// so it only counts from the end with the lower index.
+	for (int proxy = 0; proxy < proxies.size(); proxy++)
+	{
+		Proxy& p = proxies[proxy];
+
+		if (!p.alive || p.stat)
+		{
+			continue;
+		}
+
+		queryStamp++;
+		p.queryStamp = queryStamp;
+
+		for (int x = p.cellMinX; x <= p.cellMaxX; x++)
+		{
+			for (int y = p.cellMinY; y <= p.cellMaxY; y++)
+			{
+				auto cell = cells.find(Key(x, y));
+
+				if (cell == cells.end())
+				{
+					continue;
+				}
+
+				for (int other : cell->second)
+				{
+					Proxy& q = proxies[other];
+
+					if (q.queryStamp != queryStamp)
+					{
+						q.queryStamp = queryStamp;
+
+						if ((q.stat || proxy < other) && Interacts(p.layer, p.mask, q.layer, q.mask) && Overlaps(p.box, q.box))
+						{
+							out.push_back({ p.collider, q.collider });
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+SpatialHash::SpatialHash(float cellSize)
+{
+	this->cellSize = cellSize;
+}
+
+#pragma endregion
+
+#pragma region AABB Tree
+
+static AABB Union(const AABB& a, const AABB& b)
+{
+	return { std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY) };
+}
+
+static bool Contains(const AABB& outer, const AABB& inner)
+{
+	return outer.minX <= inner.minX && outer.minY <= inner.minY && outer.maxX >= inner.maxX && outer.maxY >= inner.maxY;
+}
+
+// In 2D, the perimeter plays the part surface area does in 3D: it's proportional to how likely a random query is to hit the box.
+static float Perimeter(const AABB& box)
+{
+	return 2.0f * ((box.maxX - box.minX) + (box.maxY - box.minY));
+}
+
+int AABBTree::AllocateNode()
+{
+	int node;
+
+	if (freeNodes.size() > 0)
+	{
+		node = freeNodes.back();
+		freeNodes.pop_back();
+	}
+	else
+	{
+		node = nodes.size();
+		nodes.push_back(Node());
+	}
+
+	Node& n = nodes[node];
+	n.collider = nullptr;
+	n.stat = false;
+	n.parent = -1;
+	n.left = -1;
+	n.right = -1;
+	n.height = 0;
+	return node;
+}
+
+void AABBTree::FreeNode(int node)
+{
+	nodes[node].collider = nullptr;
+	nodes[node].height = -1;
+	freeNodes.push_back(node);
+}
+
+AABB AABBTree::Fatten(const AABB& box, bool stat)
+{
+	// Static colliders don't move, so there's no point padding them.
+	if (stat)
+	{
+		return box;
+	}
+
+	return { box.minX - margin, box.minY - margin, box.maxX + margin, box.maxY + margin };
+}
+
+int AABBTree::CreateProxy(ColliderComponent* collider, const AABB& box, bool stat, uint32_t layer, uint32_t mask)
+{
+	int leaf = AllocateNode();
+
+	Node& n = nodes[leaf];
+	n.collider = collider;
+	n.stat = stat;
+	n.layer = layer;
+	n.mask = mask;
+	n.box = box;
+	n.fat = Fatten(box, stat);
+
+	InsertLeaf(leaf);
+
+	return leaf;
+}
+
+void AABBTree::MoveProxy(int proxy, const AABB& box)
+{
+	Node& n = nodes[proxy];
+	n.box = box;
+
+	if (Contains(n.fat, box))
+	{
+		return;
+	}
+
+	AABB fat = Fatten(box, n.stat);
+	int parent = n.parent;
+
+	if (parent != -1)
+	{
+		int sibling = (nodes[parent].left == proxy) ? nodes[parent].right : nodes[parent].left;
+
+		// If it's still touching its sibling, this is still a decent spot for it, so the leaf just grows to fit.
+		if (Overlaps(fat, nodes[sibling].fat))
+		{
+			nodes[proxy].fat = fat;
+			Refit(parent);
+			return;
+		}
+	}
+
+	RemoveLeaf(proxy);
+	nodes[proxy].fat = fat;
+	InsertLeaf(proxy);
+}
+
+void AABBTree::DestroyProxy(int proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+}
+
+void AABBTree::SetFilter(int proxy, uint32_t layer, uint32_t mask)
+{
+	nodes[proxy].layer = layer;
+	nodes[proxy].mask = mask;
+}
+
+const AABB& AABBTree::GetBox(int proxy)
+{
+	return nodes[proxy].box;
+}
+
+bool AABBTree::IsStatic(int proxy)
+{
+	return nodes[proxy].stat;
+}
+
+void AABBTree::InsertLeaf(int leaf)
+{
+	if (root == -1)
+	{
+		root = leaf;
+		nodes[leaf].parent = -1;
+		return;
+	}
+
+	// We go down the tree towards whichever child it'd cost less to put the leaf next to,
+	// and stop once making a new parent right here is cheaper than going any further.
+	AABB box = nodes[leaf].fat;
+	int index = root;
+
+	while (!nodes[index].IsLeaf())
+	{
+		const Node& n = nodes[index];
+
+		float perimeter = Perimeter(n.fat);
+		float combined = Perimeter(Union(n.fat, box));
+
+		// The cost of a new parent for this node and the leaf, and what every node below here would pay for the leaf regardless.
+		float cost = 2.0f * combined;
+		float inherited = 2.0f * (combined - perimeter);
+
+		float costs[2];
+		int children[2] = { n.left, n.right };
+
+		for (int i = 0; i < 2; i++)
+		{
+			const Node& child = nodes[children[i]];
+			float grown = Perimeter(Union(child.fat, box));
+
+			costs[i] = (child.IsLeaf() ? grown : grown - Perimeter(child.fat)) + inherited;
+		}
+
+		if (cost < costs[0] && cost < costs[1])
+		{
+			break;
+		}
+
+		index = (costs[0] < costs[1]) ? children[0] : children[1];
+	}
+
+	int sibling = index;
+	int oldParent = nodes[sibling].parent;
+	int newParent = AllocateNode();
+
+	Node& p = nodes[newParent];
+	p.parent = oldParent;
+	p.fat = Union(box, nodes[sibling].fat);
+	p.height = nodes[sibling].height + 1;
+	p.left = sibling;
+	p.right = leaf;
+
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if (oldParent == -1)
+	{
+		root = newParent;
+	}
+	else if (nodes[oldParent].left == sibling)
+	{
+		nodes[oldParent].left = newParent;
+	}
+	else
+	{
+		nodes[oldParent].right = newParent;
+	}
+
+	Refit(newParent);
+}
+
+void AABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == root)
+	{
+		root = -1;
+		return;
+	}
+
+	// The leaf's parent goes with it, and its sibling takes the parent's place.
+	int parent = nodes[leaf].parent;
+	int grandparent = nodes[parent].parent;
+	int sibling = (nodes[parent].left == leaf) ? nodes[parent].right : nodes[parent].left;
+
+	nodes[sibling].parent = grandparent;
+	nodes[leaf].parent = -1;
+
+	if (grandparent == -1)
+	{
+		root = sibling;
+		FreeNode(parent);
+		return;
+	}
+
+	if (nodes[grandparent].left == parent)
+	{
+		nodes[grandparent].left = sibling;
+	}
+	else
+	{
+		nodes[grandparent].right = sibling;
+	}
+
+	FreeNode(parent);
+	Refit(grandparent);
+}
+
+void AABBTree::Refit(int node)
+{
+	while (node != -1)
+	{
+		Node& n = nodes[node];
+
+		n.fat = Union(nodes[n.left].fat, nodes[n.right].fat);
+		n.height = 1 + std::max(nodes[n.left].height, nodes[n.right].height);
+
+		Rotate(node);
+
+		node = n.parent;
+	}
+}
+
+void AABBTree::Rotate(int node)
+{
+	// A node can swap one of its children with one of its other child's children. That doesn't change the node's own box
+	// (it still holds the same leaves), but it can shrink the other child's a lot, so we take whichever swap shrinks it the most.
+	Node& n = nodes[node];
+
+	int best = -1;
+	float bestGain = 0.0f;
+
+	// Each option is: the child that stays, which of its children gets swapped, and the child it gets swapped with.
+	int options[4][3] =
+	{
+		{ n.right, 0, n.left }, { n.right, 1, n.left },
+		{ n.left, 0, n.right }, { n.left, 1, n.right }
+	};
+
+	for (int i = 0; i < 4; i++)
+	{
+		const Node& stays = nodes[options[i][0]];
+
+		if (stays.IsLeaf())
+		{
+			continue;
+		}
+
+		int kept = (options[i][1] == 0) ? stays.right : stays.left;
+		AABB shrunk = Union(nodes[kept].fat, nodes[options[i][2]].fat);
+		float gain = Perimeter(stays.fat) - Perimeter(shrunk);
+
+		if (gain > bestGain)
+		{
+			best = i;
+			bestGain = gain;
+		}
+	}
+
+	if (best == -1)
+	{
+		return;
+	}
+
+	int stays = options[best][0];
+	int moving = options[best][2];
+	int grandchild = (options[best][1] == 0) ? nodes[stays].left : nodes[stays].right;
+
+	// The grandchild moves up to where the other child was, and that child moves down in its place.
+	if (options[best][1] == 0)
+	{
+		nodes[stays].left = moving;
+	}
+	else
+	{
+		nodes[stays].right = moving;
+	}
+
+	if (nodes[node].left == moving)
+	{
+		nodes[node].left = grandchild;
+	}
+	else
+	{
+		nodes[node].right = grandchild;
+	}
+
+	nodes[moving].parent = stays;
+	nodes[grandchild].parent = node;
+
+	Node& s = nodes[stays];
+	s.fat = Union(nodes[s.left].fat, nodes[s.right].fat);
+	s.height = 1 + std::max(nodes[s.left].height, nodes[s.right].height);
+
+	Node& n2 = nodes[node];
+	n2.height = 1 + std::max(nodes[n2.left].height, nodes[n2.right].height);
+}
+
+void AABBTree::Query(const AABB& box, std::vector<ColliderComponent*>& out)
+{
+	if (root == -1)
+	{
+		return;
+	}
+
+	stack.clear();
+	stack.push_back(root);
+
+	while (stack.size() > 0)
+	{
+		const Node& n = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!Overlaps(n.fat, box))
+		{
+			continue;
+		}
+
+		if (n.IsLeaf())
+		{
+			if (Overlaps(n.box, box))
+			{
+				out.push_back(n.collider);
+			}
+		}
+		else
+		{
+			stack.push_back(n.left);
+			stack.push_back(n.right);
+		}
+	}
+}
+
+void AABBTree::Overlapping(int proxy, std::vector<ColliderComponent*>& out)
+{
+	const AABB box = nodes[proxy].box;
+	const uint32_t layer = nodes[proxy].layer;
+	const uint32_t mask = nodes[proxy].mask;
+
+	stack.clear();
+	stack.push_back(root);
+
+	while (stack.size() > 0)
+	{
+		int index = stack.back();
+		const Node& n = nodes[index];
+		stack.pop_back();
+
+		if (!Overlaps(n.fat, box))
+		{
+			continue;
+		}
+
+		if (n.IsLeaf())
+		{
+			if (index != proxy && Interacts(layer, mask, n.layer, n.mask) && Overlaps(n.box, box))
+			{
+				out.push_back(n.collider);
+			}
+		}
+		else
+		{
+			stack.push_back(n.left);
+			stack.push_back(n.right);
+		}
+	}
+}
+
+void AABBTree::Raycast(float fromX, float fromY, float toX, float toY, std::vector<RayHit>& out)
+{
+	if (root == -1)
+	{
+		return;
+	}
+
+	float dX = toX - fromX;
+	float dY = toY - fromY;
+	float fraction;
+
+	stack.clear();
+	stack.push_back(root);
+
+	while (stack.size() > 0)
+	{
+		const Node& n = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!RayOverlaps(n.fat, fromX, fromY, dX, dY, fraction))
+		{
+			continue;
+		}
+
+		if (n.IsLeaf())
+		{
+			if (RayOverlaps(n.box, fromX, fromY, dX, dY, fraction))
+			{
+				out.push_back({ n.collider, fraction });
+			}
+		}
+		else
+		{
+			stack.push_back(n.left);
+			stack.push_back(n.right);
+		}
+	}
+}
+
+void AABBTree::Pairs(std::vector<ColliderPair>& out)
+{
+	if (root == -1)
+	{
+		return;
+	}
+
+	// Just like the grid, every moving leaf looks for what it overlaps, and pairs of moving leaves only count from the lower index.
+	for (int leaf = 0; leaf < nodes.size(); leaf++)
+	{
+		const Node& l = nodes[leaf];
+
+		if (l.height != 0 || l.stat)
+		{
+			continue;
+		}
+
+		stack.clear();
+		stack.push_back(root);
+
+		while (stack.size() > 0)
+		{
+			int index = stack.back();
+			const Node& n = nodes[index];
+			stack.pop_back();
+
+			if (!Overlaps(n.fat, l.box))
+			{
+				continue;
+			}
+
+			if (n.IsLeaf())
+			{
+				if (index != leaf && (n.stat || leaf < index) && Interacts(l.layer, l.mask, n.layer, n.mask) && Overlaps(n.box, l.box))
+				{
+					out.push_back({ l.collider, n.collider });
+				}
+			}
+			else
+			{
+				stack.push_back(n.left);
+				stack.push_back(n.right);
+			}
+		}
+	}
+}
+
+int AABBTree::Height()
+{
+	return (root == -1) ? 0 : nodes[root].height + 1;
+}
+
+AABBTree::AABBTree(float margin)
+{
+	this->margin = margin;
+}
+
+#pragma endregion
+
+#pragma region Sweep and Prune
+
+bool SweepAndPrune::Before(float value, bool max, const Endpoint& other)
+{
+	return value < other.value || (value == other.value && !max && other.max);
+}
+
+float SweepAndPrune::Min(const AABB& box, int axis)
+{
+	return (axis == 0) ? box.minX : box.minY;
+}
+
+float SweepAndPrune::Max(const AABB& box, int axis)
+{
+	return (axis == 0) ? box.maxX : box.maxY;
+}
+
+int SweepAndPrune::CreateProxy(ColliderComponent* collider, const AABB& box, bool stat, uint32_t layer, uint32_t mask)
+{
+	int proxy;
+
+	if (freeProxies.size() > 0)
+	{
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else
+	{
+		proxy = proxies.size();
+		proxies.push_back(Proxy());
+	}
+
+	Proxy& p = proxies[proxy];
+	p.collider = collider;
+	p.box = box;
+	p.stat = stat;
+	p.alive = true;
+	p.inserted = false;
+	p.layer = layer;
+	p.mask = mask;
+	p.overlaps.clear();
+
+	// Its endpoints (and its pairs) are found when it's merged in.
+	created.push_back(proxy);
+	widest = std::max(widest, box.maxX - box.minX);
+
+	return proxy;
+}
+
+void SweepAndPrune::FindPairs(int proxy)
+{
+	// Anything that overlaps the proxy has to start somewhere before it ends on the x axis (and not too far before it starts).
+	const std::vector<Endpoint>& xs = axes[0];
+	const AABB& box = proxies[proxy].box;
+
+	for (int i = FirstReaching(box.minX); i < proxies[proxy].max[0]; i++)
+	{
+		if (!xs[i].max && xs[i].proxy != proxy && Overlaps(proxies[xs[i].proxy].box, box))
+		{
+			AddPair(proxy, xs[i].proxy);
+		}
+	}
+}
+
+void SweepAndPrune::MoveProxy(int proxy, const AABB& box)
+{
+	Proxy& p = proxies[proxy];
+	AABB old = p.box;
+	p.box = box;
+
+	widest = std::max(widest, box.maxX - box.minX);
+
+	// If it hasn't been merged in yet, it'll go in wherever it is by then.
+	if (!p.inserted)
+	{
+		return;
+	}
+
+	for (int axis = 0; axis < 2; axis++)
+	{
+		axes[axis][p.min[axis]].value = Min(box, axis);
+		axes[axis][p.max[axis]].value = Max(box, axis);
+
+		// The endpoint on the leading side goes first, so the proxy's own endpoints never have to pass each other.
+		if (Min(box, axis) < Min(old, axis))
+		{
+			SortEndpoint(axis, p.min[axis]);
+			SortEndpoint(axis, p.max[axis]);
+		}
+		else
+		{
+			SortEndpoint(axis, p.max[axis]);
+			SortEndpoint(axis, p.min[axis]);
+		}
+	}
+}
+
+void SweepAndPrune::DestroyProxy(int proxy)
+{
+	while (proxies[proxy].overlaps.size() > 0)
+	{
+		RemovePair(proxy, proxies[proxy].overlaps.back());
+	}
+
+	// Its endpoints stay where they are (and are skipped over) until the next Flush() takes them out, and only then can the proxy be reused.
+	proxies[proxy].alive = false;
+	proxies[proxy].collider = nullptr;
+	destroyed.push_back(proxy);
+}
+
+void SweepAndPrune::SetFilter(int proxy, uint32_t layer, uint32_t mask)
+{
+	if (proxies[proxy].layer == layer && proxies[proxy].mask == mask)
+	{
+		return;
+	}
+
+	// The pairs that don't interact anymore have to go, and the ones that do now have to be found, so it's easiest to start over.
+	while (proxies[proxy].overlaps.size() > 0)
+	{
+		RemovePair(proxy, proxies[proxy].overlaps.back());
+	}
+
+	proxies[proxy].layer = layer;
+	proxies[proxy].mask = mask;
+
+	// A proxy that hasn't been merged in yet finds its pairs then anyway.
+	if (proxies[proxy].inserted)
+	{
+		FindPairs(proxy);
+	}
+}
+
+const AABB& SweepAndPrune::GetBox(int proxy)
+{
+	return proxies[proxy].box;
+}
+
+bool SweepAndPrune::IsStatic(int proxy)
+{
+	return proxies[proxy].stat;
+}
+
+void SweepAndPrune::Flush()
+{
+	if (created.size() == 0 && destroyed.size() == 0)
+	{
+		return;
+	}
+
+	widest = 0.0f;
+
+	for (int axis = 0; axis < 2; axis++)
+	{
+		std::vector<Endpoint>& list = axes[axis];
+
+		// The new endpoints are sorted on their own (there usually aren't many), and then the two sorted lists are merged,
+		// leaving out the destroyed proxies' endpoints on the way.
+		added.clear();
+
+		for (int i = 0; i < created.size(); i++)
+		{
+			const Proxy& p = proxies[created[i]];
+
+			if (p.alive)
+			{
+				added.push_back({ Min(p.box, axis), created[i], false });
+				added.push_back({ Max(p.box, axis), created[i], true });
+			}
+		}
+
+		std::sort(added.begin(), added.end(), [](const Endpoint& a, const Endpoint& b) { return Before(a.value, a.max, b); });
+
+		merged.clear();
+		merged.reserve(list.size() + added.size());
+
+		openOld.clear();
+		openNew.clear();
+		openSlot.resize(proxies.size());
+
+		int next = 0;
+
+		for (int i = 0; i < list.size(); i++)
+		{
+			while (next < added.size() && Before(added[next].value, added[next].max, list[i]))
+			{
+				Merge(axis, added[next++], true);
+			}
+
+			if (proxies[list[i].proxy].alive)
+			{
+				Merge(axis, list[i], false);
+			}
+		}
+
+		while (next < added.size())
+		{
+			Merge(axis, added[next++], true);
+		}
+
+		list.swap(merged);
+	}
+
+	for (int i = 0; i < created.size(); i++)
+	{
+		proxies[created[i]].inserted = proxies[created[i]].alive;
+	}
+
+	for (int i = 0; i < destroyed.size(); i++)
+	{
+		proxies[destroyed[i]].inserted = false;
+		freeProxies.push_back(destroyed[i]);
+	}
+
+	created.clear();
+	destroyed.clear();
+}
+
+void SweepAndPrune::Merge(int axis, const Endpoint& e, bool isNew)
+{
+	Proxy& p = proxies[e.proxy];
+
+	(e.max ? p.max : p.min)[axis] = merged.size();
+	merged.push_back(e);
+
+	// Pairs only have to be found once, so only the sweep along the x axis bothers. Whatever it's inside of when a box starts
+	// overlaps that box on the x axis; pairs of old proxies are already known, so only the ones with a new proxy in them are checked.
+	if (axis != 0)
+	{
+		return;
+	}
+
+	std::vector<int>& open = isNew ? openNew : openOld;
+
+	if (e.max)
+	{
+		int slot = openSlot[e.proxy];
+		open[slot] = open.back();
+		openSlot[open[slot]] = slot;
+		open.pop_back();
+		return;
+	}
+
+	widest = std::max(widest, p.box.maxX - p.box.minX);
+
+	if (isNew)
+	{
+		for (int i = 0; i < openOld.size(); i++)
+		{
+			if (Overlaps(proxies[openOld[i]].box, p.box))
+			{
+				AddPair(e.proxy, openOld[i]);
+			}
+		}
+	}
+
+	for (int i = 0; i < openNew.size(); i++)
+	{
+		if (Overlaps(proxies[openNew[i]].box, p.box))
+		{
+			AddPair(e.proxy, openNew[i]);
+		}
+	}
+
+	openSlot[e.proxy] = open.size();
+	open.push_back(e.proxy);
+}
+
+int SweepAndPrune::FirstReaching(float minX)
+{
+	// We go back a hair further than the widest proxy, so rounding can't make us start just past one that reaches exactly that far.
+	float from = minX - widest;
+	from -= (widest + std::abs(from)) * 1e-6f;
+
+	const std::vector<Endpoint>& xs = axes[0];
+	return std::lower_bound(xs.begin(), xs.end(), from, [](const Endpoint& e, float value) { return e.value < value; }) - xs.begin();
+}
+
+void SweepAndPrune::SortEndpoint(int axis, int index)
+{
+	std::vector<Endpoint>& list = axes[axis];
+	Endpoint e = list[index];
+	Proxy& p = proxies[e.proxy];
+
+	// Sliding left: a min passing a max means the two just started overlapping on this axis, and a max passing a min means they just stopped.
+	while (index > 0 && Before(e.value, e.max, list[index - 1]))
+	{
+		Endpoint o = list[index - 1];
+
+		if (o.proxy != e.proxy)
+		{
+			if (!e.max && o.max)
+			{
+				if (Overlaps(p.box, proxies[o.proxy].box))
+				{
+					AddPair(e.proxy, o.proxy);
+				}
+			}
+			else if (e.max && !o.max)
+			{
+				RemovePair(e.proxy, o.proxy);
+			}
+		}
+
+		list[index] = o;
+		(o.max ? proxies[o.proxy].max : proxies[o.proxy].min)[axis] = index;
+		index--;
+	}
+
+	// Sliding right is the same the other way around.
+	while (index + 1 < list.size() && Before(list[index + 1].value, list[index + 1].max, e))
+	{
+		Endpoint o = list[index + 1];
+
+		if (o.proxy != e.proxy)
+		{
+			if (e.max && !o.max)
+			{
+				if (Overlaps(p.box, proxies[o.proxy].box))
+				{
+					AddPair(e.proxy, o.proxy);
+				}
+			}
+			else if (!e.max && o.max)
+			{
+				RemovePair(e.proxy, o.proxy);
+			}
+		}
+
+		list[index] = o;
+		(o.max ? proxies[o.proxy].max : proxies[o.proxy].min)[axis] = index;
+		index++;
+	}
+
+	list[index] = e;
+	(e.max ? p.max : p.min)[axis] = index;
+}
+
+void SweepAndPrune::AddPair(int a, int b)
+{
+	Proxy& pA = proxies[a];
+	Proxy& pB = proxies[b];
+
+	// Destroyed proxies' endpoints are still in the lists until the next Flush(), so moving proxies can run into them.
+	if (!pA.alive || !pB.alive || (pA.stat && pB.stat) || !Interacts(pA.layer, pA.mask, pB.layer, pB.mask))
+	{
+		return;
+	}
+
+	// A pair can start overlapping on both axes in the same move, so it might already be here.
+	const std::vector<int>& shorter = (pA.overlaps.size() < pB.overlaps.size()) ? pA.overlaps : pB.overlaps;
+	int other = (pA.overlaps.size() < pB.overlaps.size()) ? b : a;
+
+	if (std::find(shorter.begin(), shorter.end(), other) != shorter.end())
+	{
+		return;
+	}
+
+	pA.overlaps.push_back(b);
+	pB.overlaps.push_back(a);
+
+	if (recordEvents)
+	{
+		began.push_back({ pA.collider, pB.collider });
+	}
+}
+
+void SweepAndPrune::RemovePair(int a, int b)
+{
+	std::vector<int>& overlapsA = proxies[a].overlaps;
+	auto it = std::find(overlapsA.begin(), overlapsA.end(), b);
+
+	if (it == overlapsA.end())
+	{
+		return;
+	}
+
+	*it = overlapsA.back();
+	overlapsA.pop_back();
+
+	std::vector<int>& overlapsB = proxies[b].overlaps;
+	it = std::find(overlapsB.begin(), overlapsB.end(), a);
+	*it = overlapsB.back();
+	overlapsB.pop_back();
+
+	if (recordEvents)
+	{
+		ended.push_back({ proxies[a].collider, proxies[b].collider });
+	}
+}
+
+void SweepAndPrune::Query(const AABB& box, std::vector<ColliderComponent*>& out)
+{
+	Flush();
+
+	const std::vector<Endpoint>& xs = axes[0];
+
+	for (int i = FirstReaching(box.minX); i < xs.size() && xs[i].value <= box.maxX; i++)
+	{
+		if (!xs[i].max && Overlaps(proxies[xs[i].proxy].box, box))
+		{
+			out.push_back(proxies[xs[i].proxy].collider);
+		}
+	}
+}
+
+void SweepAndPrune::Overlapping(int proxy, std::vector<ColliderComponent*>& out)
+{
+	Flush();
+
+	Proxy& p = proxies[proxy];
+
+	if (p.stat)
+	{
+		const std::vector<Endpoint>& xs = axes[0];
+
+		for (int i = FirstReaching(p.box.minX); i < p.max[0]; i++)
+		{
+			const Proxy& q = proxies[xs[i].proxy];
+
+			if (!xs[i].max && xs[i].proxy != proxy && Interacts(p.layer, p.mask, q.layer, q.mask) && Overlaps(q.box, p.box))
+			{
+				out.push_back(q.collider);
+			}
+		}
+
+		return;
+	}
+
+	for (int i = 0; i < p.overlaps.size(); i++)
+	{
+		out.push_back(proxies[p.overlaps[i]].collider);
+	}
+}
+
+void SweepAndPrune::Raycast(float fromX, float fromY, float toX, float toY, std::vector<RayHit>& out)
+{
+	Flush();
+
+	AABB bounds = { std::min(fromX, toX), std::min(fromY, toY), std::max(fromX, toX), std::max(fromY, toY) };
+	const std::vector<Endpoint>& xs = axes[0];
+	float fraction;
+
+	for (int i = FirstReaching(bounds.minX); i < xs.size() && xs[i].value <= bounds.maxX; i++)
+	{
+		const Proxy& p = proxies[xs[i].proxy];
+
+		if (!xs[i].max && Overlaps(p.box, bounds) && RayOverlaps(p.box, fromX, fromY, toX - fromX, toY - fromY, fraction))
+		{
+			out.push_back({ p.collider, fraction });
+		}
+	}
+}
+
+void SweepAndPrune::Pairs(std::vector<ColliderPair>& out)
+{
+	Flush();
+
+	// Every pair's in both proxies' lists, so it only counts from the lower index.
+	for (int i = 0; i < proxies.size(); i++)
+	{
+		const Proxy& p = proxies[i];
+
+		for (int j = 0; j < p.overlaps.size(); j++)
+		{
+			if (i < p.overlaps[j])
+			{
+				out.push_back({ p.collider, proxies[p.overlaps[j]].collider });
+			}
+		}
+	}
+}
+
+void SweepAndPrune::ClearEvents()
+{
+	began.clear();
+	ended.clear();
+}
+
+#pragma endregion
+
+#pragma region Brute Force
+
+int BruteForceBroadphase::CreateProxy(ColliderComponent* collider, const AABB& box, bool stat, uint32_t layer, uint32_t mask)
+{
+	int proxy;
+
+	if (freeProxies.size() > 0)
+	{
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else
+	{
+		proxy = proxies.size();
+		proxies.push_back(Proxy());
+	}
+
+	proxies[proxy] = { collider, box, stat, true, layer, mask };
+	return proxy;
+}
+
+void BruteForceBroadphase::MoveProxy(int proxy, const AABB& box)
+{
+	proxies[proxy].box = box;
+}
+
+void BruteForceBroadphase::DestroyProxy(int proxy)
+{
+	proxies[proxy].alive = false;
+	proxies[proxy].collider = nullptr;
+	freeProxies.push_back(proxy);
+}
+
+void BruteForceBroadphase::SetFilter(int proxy, uint32_t layer, uint32_t mask)
+{
+	proxies[proxy].layer = layer;
+	proxies[proxy].mask = mask;
+}
+
+const AABB& BruteForceBroadphase::GetBox(int proxy)
+{
+	return proxies[proxy].box;
+}
+
+bool BruteForceBroadphase::IsStatic(int proxy)
+{
+	return proxies[proxy].stat;
+}
+
+void BruteForceBroadphase::Query(const AABB& box, std::vector<ColliderComponent*>& out)
+{
+	for (int i = 0; i < proxies.size(); i++)
+	{
+		if (proxies[i].alive && Overlaps(proxies[i].box, box))
+		{
+			out.push_back(proxies[i].collider);
+		}
+	}
+}
+
+void BruteForceBroadphase::Overlapping(int proxy, std::vector<ColliderComponent*>& out)
+{
+	const Proxy& p = proxies[proxy];
+
+	for (int i = 0; i < proxies.size(); i++)
+	{
+		const Proxy& q = proxies[i];
+
+		if (i != proxy && q.alive && Interacts(p.layer, p.mask, q.layer, q.mask) && Overlaps(q.box, p.box))
+		{
+			out.push_back(q.collider);
+		}
+	}
+}
+
+void BruteForceBroadphase::Raycast(float fromX, float fromY, float toX, float toY, std::vector<RayHit>& out)
+{
+	float fraction;
+
+	for (int i = 0; i < proxies.size(); i++)
+	{
+		if (proxies[i].alive && RayOverlaps(proxies[i].box, fromX, fromY, toX - fromX, toY - fromY, fraction))
+		{
+			out.push_back({ proxies[i].collider, fraction });
+		}
+	}
+}
+
+void BruteForceBroadphase::Pairs(std::vector<ColliderPair>& out)
+{
+	for (int i = 0; i < proxies.size(); i++)
+	{
+		const Proxy& p = proxies[i];
+
+		if (!p.alive || p.stat)
+		{
+			continue;
+		}
+
+		for (int j = 0; j < proxies.size(); j++)
+		{
+			const Proxy& q = proxies[j];
+
+			if (j != i && q.alive && (q.stat || i < j) && Interacts(p.layer, p.mask, q.layer, q.mask) && Overlaps(p.box, q.box))
+			{
+				out.push_back({ p.collider, q.collider });
+			}
+		}
+	}
+}
+
+#pragma endregion
@@ -0,0 +1,362 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+// The broadphase is the collider system's way of avoiding testing every collider against every other collider.
+// Every collider with a physics component gets a proxy holding its swept bounding box---that is, the box covering
+// where it is now and where it'll be at the end of the frame---and the narrowphase only looks at the colliders
+// whose boxes overlap.
+// Static colliders are inserted once and only moved if they actually move,
+// so the cost of the broadphase each frame scales with the number of things that are moving around.
+
+// Every proxy also carries its collider's collision layer and mask (see CollisionLayer in component.h), and two proxies only count
+// as overlapping if each one's mask has the other's layer, so pairs that could never do anything to each other
+// are thrown out here with a couple of ANDs instead of going through the narrowphase.
+
+// There are a few kinds of broadphase, and each scene can use whichever suits it (see ColliderSystem::SetBroadphase()):
+// - SpatialHash buckets boxes into a uniform grid (well, a hashed grid, since our levels don't have fixed bounds).
+//   It's the default, and it's great as long as everything's about the same size as a cell.
+// - AABBTree keeps the boxes in a bounding volume hierarchy, which doesn't care how big anything is;
+//   that's better for levels that mix huge floors with tiny bullets (a floor covers hundreds of grid cells).
+// - SweepAndPrune keeps every box's edges sorted along both axes from one frame to the next and tracks which boxes overlap as edges pass each other.
+//   Since most things barely move between frames, keeping the edges sorted is cheap, and it costs about as much as the overlaps changing do.
+// - BruteForceBroadphase tests everything against everything. It's only there to check (and benchmark) the others against.
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+class ColliderComponent;
+
+struct AABB
+{
+	float minX;
+	float minY;
+	float maxX;
+	float maxY;
+};
+
+inline bool Overlaps(const AABB& a, const AABB& b)
+{
+	// This is inclusive on purpose; the narrowphase counts touching edges as hits,
+	// so the broadphase has to hand those pairs over too.
+	return (a.minX <= b.maxX && a.maxX >= b.minX && a.minY <= b.maxY && a.maxY >= b.minY);
+}
+
+// Whether two colliders can run into each other at all, going by their layers and masks.
+inline bool Interacts(uint32_t layerA, uint32_t maskA, uint32_t layerB, uint32_t maskB)
+{
+	return (maskA & layerB) != 0 && (maskB & layerA) != 0;
+}
+
+// Whether the segment from (fromX, fromY) to (fromX + dX, fromY + dY) crosses the box, and if so, how far along it first does (from zero to one).
+bool RayOverlaps(const AABB& box, float fromX, float fromY, float dX, float dY, float& fraction);
+
+enum class BroadphaseType { grid, tree, sweepAndPrune, bruteForce };
+
+struct ColliderPair
+{
+	ColliderComponent* a;
+	ColliderComponent* b;
+};
+
+struct RayHit
+{
+	ColliderComponent* collider;
+	float fraction;
+};
+
+class Broadphase
+{
+public:
+	virtual ~Broadphase() { }
+
+	virtual int CreateProxy(ColliderComponent* collider, const AABB& box, bool stat, uint32_t layer, uint32_t mask) = 0;
+	virtual void MoveProxy(int proxy, const AABB& box) = 0;
+	virtual void DestroyProxy(int proxy) = 0;
+
+	// For when a collider's layer or mask changes.
+	virtual void SetFilter(int proxy, uint32_t layer, uint32_t mask) = 0;
+
+	// The box the proxy was last given (not whatever the broadphase might have padded it out to).
+	virtual const AABB& GetBox(int proxy) = 0;
+	virtual bool IsStatic(int proxy) = 0;
+
+	// Appends every collider whose box overlaps the given box to out, whatever its layer; each collider is only added once.
+	virtual void Query(const AABB& box, std::vector<ColliderComponent*>& out) = 0;
+
+	// Appends every collider whose box overlaps the proxy's own box (besides the proxy's own collider) and that it interacts with to out.
+	// This is what the collider system asks about each collider.
+	virtual void Overlapping(int proxy, std::vector<ColliderComponent*>& out) = 0;
+
+	// Appends every collider whose box the segment crosses to out, in no particular order.
+	virtual void Raycast(float fromX, float fromY, float toX, float toY, std::vector<RayHit>& out) = 0;
+
+	// Appends every pair of overlapping boxes that interact, where at least one of the two isn't static (two static colliders never run into each other).
+	// Each pair only shows up once.
+	virtual void Pairs(std::vector<ColliderPair>& out) = 0;
+};
+
+Broadphase* CreateBroadphase(BroadphaseType type);
+
+class SpatialHash : public Broadphase
+{
+public:
+	float cellSize;
+
+	int CreateProxy(ColliderComponent* collider, const AABB& box, bool stat, uint32_t layer, uint32_t mask) override;
+	void MoveProxy(int proxy, const AABB& box) override;
+	void DestroyProxy(int proxy) override;
+	void SetFilter(int proxy, uint32_t layer, uint32_t mask) override;
+
+	const AABB& GetBox(int proxy) override;
+	bool IsStatic(int proxy) override;
+
+	void Query(const AABB& box, std::vector<ColliderComponent*>& out) override;
+	void Overlapping(int proxy, std::vector<ColliderComponent*>& out) override;
+	void Raycast(float fromX, float fromY, float toX, float toY, std::vector<RayHit>& out) override;
+	void Pairs(std::vector<ColliderPair>& out) override;
+
+	SpatialHash(float cellSize);
+
+private:
+	struct Proxy
+	{
+		ColliderComponent* collider;
+		AABB box;
+
+		int cellMinX;
+		int cellMinY;
+		int cellMaxX;
+		int cellMaxY;
+
+		uint32_t queryStamp;
+		bool stat;
+		bool alive;
+
+		uint32_t layer;
+		uint32_t mask;
+	};
+
+	std::vector<Proxy> proxies;
+	std::vector<int> freeProxies;
+	std::unordered_map<int64_t, std::vector<int>> cells;
+	uint32_t queryStamp = 0;
+
+	int CellCoord(float v);
+	int64_t Key(int x, int y);
+	void Insert(int proxy);
+	void Remove(int proxy);
+};
+
+// The tree is built the same way Box2D's is: leaves are inserted next to whichever node makes the tree's total perimeter grow the least,
+// and each leaf's box is padded out by a margin, so a collider that only moves a little doesn't have to move in the tree at all.
+// When one does slip out of its padding, if it's still touching its sibling its leaf is just grown to fit and its ancestors refit on the way up;
+// otherwise it's taken out and inserted again somewhere better.
+// Either way, every node on the way back up gets the chance to swap one of its children with a grandchild
+// if that makes the boxes tighter, which is what keeps the tree from degrading as things move around.
+class AABBTree : public Broadphase
+{
+public:
+	// How far (in world units) a moving collider's box is padded out in the tree.
+	float margin;
+
+	int CreateProxy(ColliderComponent* collider, const AABB& box, bool stat, uint32_t layer, uint32_t mask) override;
+	void MoveProxy(int proxy, const AABB& box) override;
+	void DestroyProxy(int proxy) override;
+	void SetFilter(int proxy, uint32_t layer, uint32_t mask) override;
+
+	const AABB& GetBox(int proxy) override;
+	bool IsStatic(int proxy) override;
+
+	void Query(const AABB& box, std::vector<ColliderComponent*>& out) override;
+	void Overlapping(int proxy, std::vector<ColliderComponent*>& out) override;
+	void Raycast(float fromX, float fromY, float toX, float toY, std::vector<RayHit>& out) override;
+	void Pairs(std::vector<ColliderPair>& out) override;
+
+	// How many levels deep the tree goes (zero when it's empty), for keeping an eye on how balanced it is.
+	int Height();
+
+	AABBTree(float margin);
+
+private:
+	struct Node
+	{
+		// The padded box (for leaves) or the box around both children (for everything else).
+		AABB fat;
+
+		// Leaves only: the box the proxy was actually given.
+		AABB box;
+		ColliderComponent* collider;
+		bool stat;
+		uint32_t layer;
+		uint32_t mask;
+
+		int parent;
+		int left;
+		int right;
+		int height;
+
+		bool IsLeaf() const { return left == -1; }
+	};
+
+	std::vector<Node> nodes;
+	std::vector<int> freeNodes;
+	int root = -1;
+
+	// The traversal stack, kept around so queries don't allocate.
+	std::vector<int> stack;
+
+	int AllocateNode();
+	void FreeNode(int node);
+
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+
+	// Walks from the given node up to the root, refitting boxes and heights and rotating wherever it tightens things up.
+	void Refit(int node);
+	void Rotate(int node);
+
+	AABB Fatten(const AABB& box, bool stat);
+};
+
+// This is the classic incremental sweep and prune: every proxy has a min and a max endpoint on each axis, the endpoints are kept sorted
+// by insertion sort, and whenever one endpoint passes another, the two proxies either just started overlapping on that axis
+// (so we check the other axis and add the pair if they overlap there too) or just stopped (so the pair goes, if there was one).
+// The current pairs are kept as a list on each proxy, so finding a collider's candidates is just reading its list.
+// Creating and destroying proxies doesn't touch the endpoint lists straight away (inserting into the middle of one means moving
+// and renumbering everything after it); they're queued up, and the next query (or Flush()) merges them all in at once in a single pass
+// over each axis, finding the new proxies' pairs as it goes.
+// Pairs of static proxies are never tracked; a static proxy asking what it overlaps has to walk the x axis instead, as do queries and raycasts
+// (which don't start from a proxy). Nothing wider than the widest proxy can start more than that far to the left of where a box starts,
+// so they only walk the stretch of the axis from there to where the box ends, not the whole thing.
+class SweepAndPrune : public Broadphase
+{
+public:
+	// When this is on, every pair that starts or stops overlapping is recorded in began or ended (until ClearEvents() is called).
+	bool recordEvents = false;
+	std::vector<ColliderPair> began;
+	std::vector<ColliderPair> ended;
+
+	int CreateProxy(ColliderComponent* collider, const AABB& box, bool stat, uint32_t layer, uint32_t mask) override;
+	void MoveProxy(int proxy, const AABB& box) override;
+	void DestroyProxy(int proxy) override;
+	void SetFilter(int proxy, uint32_t layer, uint32_t mask) override;
+
+	const AABB& GetBox(int proxy) override;
+	bool IsStatic(int proxy) override;
+
+	void Query(const AABB& box, std::vector<ColliderComponent*>& out) override;
+	void Overlapping(int proxy, std::vector<ColliderComponent*>& out) override;
+	void Raycast(float fromX, float fromY, float toX, float toY, std::vector<RayHit>& out) override;
+	void Pairs(std::vector<ColliderPair>& out) override;
+
+	void ClearEvents();
+
+	// Merges every proxy created or destroyed since last time into the endpoint lists; queries do this themselves when they have to.
+	void Flush();
+
+private:
+	struct Endpoint
+	{
+		float value;
+		int proxy;
+		bool max;
+	};
+
+	struct Proxy
+	{
+		ColliderComponent* collider;
+		AABB box;
+		bool stat;
+		bool alive;
+
+		// Whether its endpoints are in the lists yet; a new proxy's aren't until the next Flush(), and a destroyed one's stay there until then.
+		bool inserted;
+
+		uint32_t layer;
+		uint32_t mask;
+
+		// Where the proxy's endpoints are in each axis's list.
+		int min[2];
+		int max[2];
+
+		// The other proxies this one currently overlaps.
+		std::vector<int> overlaps;
+	};
+
+	std::vector<Endpoint> axes[2];
+	std::vector<Proxy> proxies;
+	std::vector<int> freeProxies;
+
+	// The proxies waiting for the next Flush() to put their endpoints in, or take them out; destroyed proxies aren't reused until then.
+	std::vector<int> created;
+	std::vector<int> destroyed;
+
+	// At least as wide as the widest proxy on the x axis (it's worked out again from scratch on every Flush()).
+	float widest = 0.0f;
+
+	// Flush()'s scratch space: the new endpoints, the merged list, and which proxies the sweep along the x axis is inside of
+	// (split into the ones that were already there and the new ones, and where each one is in its list).
+	std::vector<Endpoint> added;
+	std::vector<Endpoint> merged;
+	std::vector<int> openOld;
+	std::vector<int> openNew;
+	std::vector<int> openSlot;
+
+	// Whether an endpoint with this value (and kind) goes before the other one; mins go before maxes at the same value,
+	// so boxes that only touch still count as overlapping.
+	static bool Before(float value, bool max, const Endpoint& other);
+
+	float Min(const AABB& box, int axis);
+	float Max(const AABB& box, int axis);
+
+	// Puts an endpoint into the merged list during Flush(), pairing up new proxies with whatever they overlap as the sweep passes them.
+	void Merge(int axis, const Endpoint& e, bool isNew);
+
+	// The first endpoint on the x axis that could belong to a box reaching as far as minX.
+	int FirstReaching(float minX);
+
+	// Adds every pair the proxy's in, for when its filter's changed and the pairs have to be found again.
+	void FindPairs(int proxy);
+
+	// Slides an endpoint into place after its value's changed, adding and removing pairs as it passes other proxies' endpoints.
+	void SortEndpoint(int axis, int index);
+
+	void AddPair(int a, int b);
+	void RemovePair(int a, int b);
+};
+
+// Everything against everything; see above.
+class BruteForceBroadphase : public Broadphase
+{
+public:
+	int CreateProxy(ColliderComponent* collider, const AABB& box, bool stat, uint32_t layer, uint32_t mask) override;
+	void MoveProxy(int proxy, const AABB& box) override;
+	void DestroyProxy(int proxy) override;
+	void SetFilter(int proxy, uint32_t layer, uint32_t mask) override;
+
+	const AABB& GetBox(int proxy) override;
+	bool IsStatic(int proxy) override;
+
+	void Query(const AABB& box, std::vector<ColliderComponent*>& out) override;
+	void Overlapping(int proxy, std::vector<ColliderComponent*>& out) override;
+	void Raycast(float fromX, float fromY, float toX, float toY, std::vector<RayHit>& out) override;
+	void Pairs(std::vector<ColliderPair>& out) override;
+
+private:
+	struct Proxy
+	{
+		ColliderComponent* collider;
+		AABB box;
+		bool stat;
+		bool alive;
+
+		uint32_t layer;
+		uint32_t mask;
+	};
+
+	std::vector<Proxy> proxies;
+	std::vector<int> freeProxies;
+};
+
+#endif
@@ -8,6 +8,8 @@
 
 #include "renderer.h"
 #include "particleengine.h"
+#include "componentpool.h"
+#include "entity.h"
 #include <math.h>
 #include <map>
 #include <vector>
@@ -16,30 +18,104 @@ class Entity;
 
 // There is surely a more elegant way to handle IDs; we could dynamically assign them at runtime,
 // but honestly, this works so I'm not particularly compelled to change it.
-static int positionComponentID = 1;
-static int physicsComponentID = 2;
-static int spriteComponentID = 3;
-static int colliderComponentID = 4;
-static int inputComponentID = 5;
-static int animationComponentID = 6;
-static int animationControllerComponentID = 7;
-static int cameraFollowComponentID = 8;
-static int movementComponentID = 9;
-static int healthComponentID = 10;
-static int duelistComponentID = 11;
-static int damageComponentID = 12;
-static int particleComponentID = 13;
-static int aiComponentID = 14;
-static int bladeComponentID = 15;
-static int imageComponentID = 16;
-static int buttonComponentID = 17;
-static int textComponentID = 18;
+// They're constexpr so that lookups by type (entity->Get<T>()) boil down to a constant index.
+constexpr int positionComponentID = 1;
+constexpr int physicsComponentID = 2;
+constexpr int spriteComponentID = 3;
+constexpr int colliderComponentID = 4;
+constexpr int inputComponentID = 5;
+constexpr int animationComponentID = 6;
+constexpr int animationControllerComponentID = 7;
+constexpr int cameraFollowComponentID = 8;
+constexpr int movementComponentID = 9;
+constexpr int healthComponentID = 10;
+constexpr int duelistComponentID = 11;
+constexpr int damageComponentID = 12;
+constexpr int particleComponentID = 13;
+constexpr int aiComponentID = 14;
+constexpr int bladeComponentID = 15;
+constexpr int imageComponentID = 16;
+constexpr int buttonComponentID = 17;
+constexpr int textComponentID = 18;
+
+// And this maps each component type to its ID (the animation controllers all share one).
+class PositionComponent;
+class PhysicsComponent;
+class StaticSpriteComponent;
+class ColliderComponent;
+class InputComponent;
+class AnimationComponent;
+class AnimationControllerComponent;
+class PlayerAnimationControllerComponent;
+class MoonlightBladeAnimationControllerComponent;
+class CameraFollowComponent;
+class MovementComponent;
+class HealthComponent;
+class DamageComponent;
+class ParticleComponent;
+class AIComponent;
+class BladeComponent;
+class ImageComponent;
+class ButtonComponent;
+class TextComponent;
+
+template <> constexpr int ComponentId<PositionComponent>() { return positionComponentID; }
+template <> constexpr int ComponentId<PhysicsComponent>() { return physicsComponentID; }
+template <> constexpr int ComponentId<StaticSpriteComponent>() { return spriteComponentID; }
+template <> constexpr int ComponentId<ColliderComponent>() { return colliderComponentID; }
+template <> constexpr int ComponentId<InputComponent>() { return inputComponentID; }
+template <> constexpr int ComponentId<AnimationComponent>() { return animationComponentID; }
+template <> constexpr int ComponentId<AnimationControllerComponent>() { return animationControllerComponentID; }
+template <> constexpr int ComponentId<PlayerAnimationControllerComponent>() { return animationControllerComponentID; }
+template <> constexpr int ComponentId<MoonlightBladeAnimationControllerComponent>() { return animationControllerComponentID; }
+template <> constexpr int ComponentId<CameraFollowComponent>() { return cameraFollowComponentID; }
+template <> constexpr int ComponentId<MovementComponent>() { return movementComponentID; }
+template <> constexpr int ComponentId<HealthComponent>() { return healthComponentID; }
+template <> constexpr int ComponentId<DamageComponent>() { return damageComponentID; }
+template <> constexpr int ComponentId<ParticleComponent>() { return particleComponentID; }
+template <> constexpr int ComponentId<AIComponent>() { return aiComponentID; }
+template <> constexpr int ComponentId<BladeComponent>() { return bladeComponentID; }
+template <> constexpr int ComponentId<ImageComponent>() { return imageComponentID; }
+template <> constexpr int ComponentId<ButtonComponent>() { return buttonComponentID; }
+template <> constexpr int ComponentId<TextComponent>() { return textComponentID; }
 
 static int playerAnimControllerSubID = 1;
 static int moonlightBladeAnimControllerSubID = 2;
 
 enum EntityClass { player, enemy, object };
 
+// Every collider is on exactly one collision layer, and has a mask of the layers it can run into;
+// the broadphase throws out any pair where either one's mask doesn't have the other's layer (see broadphase.h).
+// Colliders pick their layer from their flags (platform, trigger and doesDamage, then entity class) when they're made,
+// and their mask from the matrix below; anything that changes either afterwards has to call MarkChanged().
+// A damage component moves its collider onto the projectile layer if it's used up when it hits something (see DamageComponent).
+enum CollisionLayer : uint32_t
+{
+	playerLayer = 1 << 0,
+	enemyLayer = 1 << 1,
+	objectLayer = 1 << 2,
+	platformLayer = 1 << 3,
+	damageLayer = 1 << 4,		// Triggers that do damage, like the Moonlight Blade.
+	triggerLayer = 1 << 5,		// Every other trigger.
+	projectileLayer = 1 << 6,	// Damage that's used up when it hits, like bullets.
+	allLayers = 0xFFFFFFFF
+};
+
+// Which layers each layer runs into by default; it's symmetric, so it doesn't matter which side of a pair asks.
+// Platforms never do anything to each other, and neither do bullets (though bullets and the blade still do).
+inline uint32_t DefaultCollisionMask(CollisionLayer layer)
+{
+	switch (layer)
+	{
+	case platformLayer:
+		return allLayers & ~platformLayer;
+	case projectileLayer:
+		return allLayers & ~projectileLayer;
+	default:
+		return allLayers;
+	}
+}
+
 class Observer
 {
 public:
@@ -53,6 +129,24 @@ public:
 	bool active;
 	Entity* entity;
 	int ID;
+
+	// Where this component sits in its system's component list (and which scene's partition of it).
+	int denseIndex = -1;
+	int partition = 0;
+
+	// This counts frames; the ECS hub bumps it at the start of every one.
+	static inline uint32_t tick = 1;
+
+	// The frame this component was last changed in; it starts out as the frame it was made in.
+	// Systems that cache something worked out from a component (like the broadphase's cells) use this to tell
+	// whether they need to work it out again, so anything that changes a component in a way they'd care about should call MarkChanged().
+	uint32_t changed = tick;
+
+	void MarkChanged() { changed = tick; }
+
+	// Usually called with a system's lastRun; this errs on the side of saying yes, since a change made
+	// in the same frame as the system's last run might have come after it.
+	bool ChangedSince(uint32_t since) { return changed >= since; }
 };
 
 class PositionComponent : public Component
@@ -67,19 +161,23 @@ public:
 	// doesn't calculate collisions for static objects.
 	bool stat;
 
+	// This is the position's slot in the body stream; the coordinates below (and the velocity of
+	// the physics component attached to the same entity) actually live there.
+	int slot;
+
 	// These are just the basic x, y, and z coordinates for the object. Too clarify,
 	// higher z-coordinates are placed on top of those with lower ones, so an object with
 	// a z-coordinate of 100 will appear in front of one with a z-coordinate of 0. We could
 	// easily change this by flipping the '<' to an '>' in the sprite rendering system and
 	// the animation rendering system.
-	float x;
-	float y;
-	float z;
+	float& x;
+	float& y;
+	float& z;
 
 	// Rotation should only be applied to objects without colliders. I want to figure out, at some point,
 	// some efficient algorithm for calculating continuous collisions for rotating objects, but our current
 	// algorithm expects all colliders to be rectangles that are aligned with the y-axis.
-	float rotation; // In degrees.
+	float& rotation; // In degrees.
 
 	// This is the only component that should have any logic in it.
 	// I'm making an exception here for simplicity's sake.
@@ -87,8 +185,14 @@ public:
 	glm::vec2 Rotate(glm::vec2 point);
 	glm::vec2 RelativeLocation(glm::vec2 p, glm::vec2 up, glm::vec2 right);
 
+	// Moving positions change every frame, so they're always counted as changed; static ones only count
+	// when something marks them (anything that moves a static position by hand has to call MarkChanged()).
+	bool Moved(uint32_t since) { return !stat || ChangedSince(since); }
+
 	// And the constructor.
 	PositionComponent(Entity* entity, bool active, bool stat, float x, float y, float z, float rotation);
+	PositionComponent(const PositionComponent&) = delete;
+	~PositionComponent();
 };
 
 class PhysicsComponent : public Component
@@ -96,11 +200,12 @@ class PhysicsComponent : public Component
 public:
 	// This is just the velocity vector for a given object.
 	// This is in units per second.
-	float velocityX;
-	float velocityY;
+	// Like the position's coordinates, these live in the body stream (in the position's slot).
+	float& velocityX;
+	float& velocityY;
 
 	// This is rotational velocity in degrees per second.
-	float rotVelocity;
+	float& rotVelocity;
 
 	// We have a drag and baseDrag because sometimes we'll change the former
 	// but we always want to have something to tell us what the default
@@ -121,7 +226,13 @@ public:
 	// for the system to work properly. I really should either remove this or standardize it.
 	PositionComponent* pos;
 
+	// This is the position's body stream slot; we keep our own copy since the position
+	// might be destroyed before we are.
+	int slot;
+
 	PhysicsComponent(Entity* entity, bool active, PositionComponent* pos, float vX, float vY, float vR, float drag, float gravityMod);
+	PhysicsComponent(const PhysicsComponent&) = delete;
+	~PhysicsComponent();
 };
 
 class StaticSpriteComponent : public Component
@@ -179,6 +290,10 @@ public:
 
 	EntityClass entityClass;
 
+	// See CollisionLayer.
+	uint32_t layer;
+	uint32_t mask;
+
 	float mass;
 	float bounce;
 	float friction;
@@ -191,6 +306,9 @@ public:
 	float offsetY;
 	float baseOffsetY;
 
+	// This is the collider's handle in the collider system's broadphase (or -1 if it hasn't been put in yet).
+	int proxy;
+
 	PositionComponent* pos;
 
 	ColliderComponent(Entity* entity, bool active, PositionComponent* pos, bool platform, bool onewayPlatform, bool ignoreOnewayPlatforms, bool climbable, bool trigger, bool takesDamage, bool doesDamage, EntityClass entityClass, float mass, float bounce, float friction, float width, float height, float offsetX, float offsetY);
@@ -199,7 +317,7 @@ public:
 class InputComponent : public Component
 {
 public:
-	Entity* moonlightBlade;
+	EntityHandle moonlightBlade;
 	bool acceptInput;
 
 	bool releasedJump;
@@ -213,7 +331,7 @@ public:
 
 	Texture2D* baseMap;
 
-	InputComponent(Entity* entity, bool active, Entity* moonlightBlade, bool acceptInput, float maxCoyoteTime, int maxJumps, float targetDelay, Texture2D* baseMap);
+	InputComponent(Entity* entity, bool active, EntityHandle moonlightBlade, bool acceptInput, float maxCoyoteTime, int maxJumps, float targetDelay, Texture2D* baseMap);
 };
 
 class MovementComponent : public Component
@@ -316,7 +434,7 @@ public:
 class DamageComponent : public Component
 {
 public:
-	Entity* creator;
+	EntityHandle creator;
 
 	bool hasLifetime;
 	float lifetime;
@@ -333,7 +451,7 @@ public:
 	bool damagesEnemies;
 	bool damagesObjects;
 
-	DamageComponent(Entity* entity, bool active, Entity* creator, bool hasLifetime, float lifetime, bool showAfterUses, bool limitedUses, int uses, float damage, bool damagesPlayers, bool damagesEnemies, bool damagesObjects, bool lodges);
+	DamageComponent(Entity* entity, bool active, EntityHandle creator, bool hasLifetime, float lifetime, bool showAfterUses, bool limitedUses, int uses, float damage, bool damagesPlayers, bool damagesEnemies, bool damagesObjects, bool lodges);
 };
 
 class ParticleComponent : public Component
@@ -383,7 +501,8 @@ public:
 	float followSpeed;
 	float projectileSpeed;
 
-	ColliderComponent* platformCollider;
+	// This is the hilt, a separate entity whose collider becomes a platform when the blade is lodged in something.
+	EntityHandle hilt;
 
 	Texture2D* corporealMap;
 	Texture2D* incorporealMap;
@@ -392,7 +511,7 @@ public:
 	float lastTargetSet;
 	float minTargetSetDelay;
 
-	BladeComponent(Entity* entity, bool active, float rushRange, float slowRange, float followSpeed, float projectileSpeed, ColliderComponent* platformCollider, Texture2D* corporealMap, Texture2D* incorporealMap, float minTargetSetDelay);
+	BladeComponent(Entity* entity, bool active, float rushRange, float slowRange, float followSpeed, float projectileSpeed, EntityHandle hilt, Texture2D* corporealMap, Texture2D* incorporealMap, float minTargetSetDelay);
 };
 
 
@@ -435,9 +554,10 @@ public:
 
 	bool needsAllReqs;
 
-	std::vector<ButtonComponent*> exclusiveButtons;					// Buttons that should un-click when this is clicked.
-	std::vector<std::vector<ButtonComponent*>> requiredButtons;		// Categories of buttons that are needed for this to be clickable.
-	std::vector<ButtonComponent*> illegalButtons;					// Buttons that cannot be clicked for this to be clickable.
+	// These hold the entities the other buttons belong to.
+	std::vector<EntityHandle> exclusiveButtons;					// Buttons that should un-click when this is clicked.
+	std::vector<std::vector<EntityHandle>> requiredButtons;		// Categories of buttons that are needed for this to be clickable.
+	std::vector<EntityHandle> illegalButtons;					// Buttons that cannot be clicked for this to be clickable.
 
 	glm::vec4 plainColor;
 	glm::vec4 hoverColor;
@@ -475,7 +595,7 @@ public:
 class TriggerObserver : public Observer
 {
 public:
-	std::vector<ButtonComponent*> buttons;
+	std::vector<EntityHandle> buttons;
 
 	void Trigger();
 };
@@ -0,0 +1,290 @@
+#ifndef COMPONENTPOOL_H
+#define COMPONENTPOOL_H
+
+// Component pools are where components actually live.
+// Rather than calling new for every single component (and scattering them all over the heap),
+// each component type gets its own pool, which hands out slots from big, contiguous chunks.
+// Chunks are never moved once they're allocated, so pointers to components stay valid for as long
+// as the component is alive; freed slots go on a free list and get handed back out first,
+// so an entity that dies and gets replaced (like a bullet) reuses memory that's already warm.
+
+// On top of that, the hottest parts of positions and physics---the things the integrator touches every frame---
+// aren't stored in the components at all; they're stored in the body stream below as struct-of-arrays,
+// and the components just hold references into it.
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <cstdint>
+
+template <typename T, int ChunkSize = 256>
+class ComponentPool
+{
+public:
+	template <typename... Args>
+	T* Create(Args&&... args)
+	{
+		if (freeSlots.size() == 0)
+		{
+			Grow(ChunkSize);
+		}
+
+		T* slot = freeSlots.back();
+		freeSlots.pop_back();
+		live++;
+
+		return new (slot) T(std::forward<Args>(args)...);
+	}
+
+	void Destroy(T* component)
+	{
+		component->~T();
+		freeSlots.push_back(component);
+		live--;
+	}
+
+	// Makes sure the next count components can be created without allocating anything;
+	// if there isn't room, the missing slots all come from one new chunk.
+	void Reserve(int count)
+	{
+		int missing = count - (int)freeSlots.size();
+
+		if (missing > 0)
+		{
+			Grow(((missing + ChunkSize - 1) / ChunkSize) * ChunkSize);
+		}
+	}
+
+	int Count() { return live; }
+	int Capacity() { return capacity; }
+
+	ComponentPool() { }
+	ComponentPool(const ComponentPool&) = delete;
+	ComponentPool& operator=(const ComponentPool&) = delete;
+
+	~ComponentPool()
+	{
+		for (int i = 0; i < chunks.size(); i++)
+		{
+			::operator delete(chunks[i]);
+		}
+	}
+
+private:
+	std::vector<T*> chunks;
+	std::vector<T*> freeSlots;
+	int live = 0;
+	int capacity = 0;
+
+	void Grow(int slots)
+	{
+		T* chunk = (T*)::operator new(sizeof(T) * slots);
+		chunks.push_back(chunk);
+		capacity += slots;
+
+		// Anything still on the free list gets handed out first, so the new slots go underneath it;
+		// we push these backwards so that they get handed out in address order.
+		std::vector<T*> old;
+		old.swap(freeSlots);
+		freeSlots.reserve(old.size() + slots);
+
+		for (int i = slots - 1; i >= 0; i--)
+		{
+			freeSlots.push_back(chunk + i);
+		}
+
+		freeSlots.insert(freeSlots.end(), old.begin(), old.end());
+	}
+};
+
+// Partition ranges are what systems actually loop over each frame: the global partition (scene 0)
+// followed by the active scene's partition, indexed as though they were one list.
+// Every other scene's components are still sitting in their own partitions, but nobody has to walk past them.
+template <typename T>
+class PartitionRange
+{
+public:
+	PartitionRange(std::vector<std::vector<T>>* partitions, int scene)
+	{
+		this->partitions = partitions;
+		this->scene = scene;
+	}
+
+	// These look at the partitions every time, rather than caching them, since systems sometimes add components while they're looping.
+	int size()
+	{
+		int n = (*partitions)[0].size();
+		return (scene == 0) ? n : n + (*partitions)[scene].size();
+	}
+
+	T& operator[](int i)
+	{
+		std::vector<T>& global = (*partitions)[0];
+		return (i < global.size()) ? global[i] : (*partitions)[scene][i - global.size()];
+	}
+
+private:
+	std::vector<std::vector<T>>* partitions;
+	int scene;
+};
+
+// Copies everything in a range into a scratch list (which keeps its capacity from frame to frame),
+// for the systems that need to sort what they're looking at.
+template <typename T>
+void Gather(PartitionRange<T> range, std::vector<T>& out)
+{
+	out.clear();
+
+	for (int i = 0; i < range.size(); i++)
+	{
+		out.push_back(range[i]);
+	}
+}
+
+// Systems keep their components in one of these rather than a plain vector.
+// Each component remembers where it is in its system's list, so removing one is just
+// a matter of moving the last component into its place (which means the order isn't preserved;
+// systems that care about order, like the renderers, sort what they draw anyway).
+// Components are split up by the scene their entity belongs to, so that a system only ever has to look at
+// the global scene and the active one; switching scenes is just a matter of asking for a different partition.
+// Note that a component is filed under whatever scene its entity had when it was registered,
+// so entities should be given their scene when they're created.
+template <typename T>
+class ComponentList
+{
+public:
+	// One list per scene, indexed by the scene's number.
+	std::vector<std::vector<T*>> partitions;
+
+	// This goes up every time a component is added or removed, so systems can tell when anything they've gathered is out of date.
+	uint32_t version = 0;
+
+	ComponentList() : partitions(1) { }
+
+	void Add(T* component)
+	{
+		std::vector<T*>& items = Partition(component->entity->Get_Scene());
+
+		component->partition = component->entity->Get_Scene();
+		component->denseIndex = items.size();
+		items.push_back(component);
+		version++;
+	}
+
+	void Remove(T* component)
+	{
+		std::vector<T*>& items = partitions[component->partition];
+
+		int i = component->denseIndex;
+		T* last = items.back();
+
+		items[i] = last;
+		last->denseIndex = i;
+		items.pop_back();
+
+		component->denseIndex = -1;
+		version++;
+	}
+
+	// This needs to be called after anything reorders a partition (like a sort).
+	void Reindex(int scene)
+	{
+		std::vector<T*>& items = Partition(scene);
+
+		for (int i = 0; i < items.size(); i++)
+		{
+			items[i]->denseIndex = i;
+		}
+	}
+
+	std::vector<T*>& Partition(int scene)
+	{
+		if (scene >= partitions.size())
+		{
+			partitions.resize(scene + 1);
+		}
+
+		return partitions[scene];
+	}
+
+	// The components in the global scene and the given one.
+	PartitionRange<T*> Active(int activeScene)
+	{
+		Partition(activeScene);
+		return PartitionRange<T*>(&partitions, activeScene);
+	}
+
+	// The number of components across every scene.
+	int size()
+	{
+		int n = 0;
+
+		for (int i = 0; i < partitions.size(); i++)
+		{
+			n += partitions[i].size();
+		}
+
+		return n;
+	}
+};
+
+class BodyStream
+{
+public:
+	static constexpr int ChunkSize = 256;
+
+	// Each chunk holds the same fields for a run of slots, one array per field,
+	// so the integrator can walk straight through them.
+	struct Chunk
+	{
+		float x[ChunkSize];
+		float y[ChunkSize];
+		float z[ChunkSize];
+		float rotation[ChunkSize];
+
+		float velocityX[ChunkSize];
+		float velocityY[ChunkSize];
+		float rotVelocity[ChunkSize];
+
+		int scene[ChunkSize];
+
+		// Whether the slot belongs to an active position with physics attached.
+		uint8_t moving[ChunkSize];
+
+		// Where each slot was before the last simulation step, so that rendering can draw moving things
+		// partway between that and where they are now (see Interpolate()).
+		float previousX[ChunkSize];
+		float previousY[ChunkSize];
+		float previousRotation[ChunkSize];
+
+		// Where the simulation actually has things while they're being drawn somewhere in between.
+		float simulatedX[ChunkSize];
+		float simulatedY[ChunkSize];
+		float simulatedRotation[ChunkSize];
+	};
+
+	static BodyStream main;
+
+	std::vector<Chunk*> chunks;
+	std::vector<int> freeSlots;
+
+	// One past the highest slot ever handed out; the integrator doesn't need to look beyond it.
+	int end = 0;
+
+	int Allocate(int scene);
+	void Free(int slot);
+
+	// Called before every simulation step; remembers where everything is now.
+	void Snapshot();
+
+	// Moves every moving slot to alpha of the way between its last snapshot and where it is now (for rendering),
+	// and Restore() puts them back where the simulation left them. Nothing else is touched, so anything
+	// that gets positioned while rendering (like UI) is left alone.
+	void Interpolate(float alpha);
+	void Restore();
+
+	Chunk& ChunkOf(int slot) { return *chunks[slot / ChunkSize]; }
+	int Lane(int slot) { return slot % ChunkSize; }
+};
+
+#endif
@@ -14,6 +14,9 @@
 #include "system.h"
 #include "component.h"
 #include "entity.h"
+#include "prefab.h"
+#include "profiler.h"
+#include "narrowphase.h"
 #include <algorithm>
 
 #pragma region Utility
@@ -46,115 +49,166 @@ bool RectOverlapRect(glm::vec2 rectA, float aWidth, float aHeight, glm::vec2 rec
 	return (aBL.x < bTR.x&& aTR.x > bBL.x && aBL.y < bTR.y&& aTR.y > bBL.y);
 }
 
-bool RayOverlapRect(glm::vec2 rayOrigin, glm::vec2 rayDir, glm::vec2 rectCenter, float rWidth, float rHeight,
-					glm::vec2& contactPoint, glm::vec2& contactNormal, float& tHitNear)
+glm::vec2 lerp(glm::vec2 pos, glm::vec2 tar, float step)
 {
-	glm::vec2 invertDir = 1.0f / rayDir;
+	return (pos * (1.0f - step) + (tar * step));
+}
 
-	glm::vec2 rBL = glm::vec2(rectCenter.x - (rWidth / 2.0f), rectCenter.y - (rHeight / 2.0f));
-	glm::vec2 rTR = glm::vec2(rectCenter.x + (rWidth / 2.0f), rectCenter.y + (rHeight / 2.0f));
+float Dot(glm::vec2 a, glm::vec2 b)
+{
+	return a.x * b.x + a.y * b.y;
+}
+#pragma endregion
 
-	glm::vec2 tNear = (rBL - rayOrigin) * invertDir;
-	glm::vec2 tFar = (rTR - rayOrigin) * invertDir;
+#pragma region Entities
 
-	if (std::isnan(tFar.y) || std::isnan(tFar.x))
-	{
-		return false;
-	}
-	if (std::isnan(tNear.y) || std::isnan(tNear.x))
-	{
-		return false;
-	}
+uint32_t Entity::Get_ID() { return ID; }
+EntityHandle Entity::Get_Handle() { EntityHandle h; h.value = ID; return h; }
+int Entity::Get_Scene() { return scene; }
+const std::string& Entity::Get_Name() { return ECS::main.registry.names.Get(nameID); }
+int Entity::Get_NameID() { return nameID; }
 
-	if (tNear.x > tFar.x)
-	{
-		std::swap(tNear.x, tFar.x);
-	}
-	if (tNear.y > tFar.y)
-	{
-		std::swap(tNear.y, tFar.y);
-	}
+void Entity::Set_ID(uint32_t newID) { ID = newID; }
+void Entity::Set_Scene(int newScene)
+{
+	scene = newScene;
+
+	// The body stream keeps its own copy of the scene so the integrator doesn't have to come back here.
+	PositionComponent* p = Get<PositionComponent>();
 
-	if (tNear.x > tFar.y || tNear.y > tFar.x)
+	if (p != nullptr)
 	{
-		return false;
+		int slot = p->slot;
+		BodyStream::main.ChunkOf(slot).scene[BodyStream::main.Lane(slot)] = newScene;
 	}
+}
+void Entity::Set_Name(const std::string& newName)
+{
+	int oldID = nameID;
+	nameID = ECS::main.registry.names.Intern(newName);
+	ECS::main.registry.Rename(this, oldID, nameID);
+}
+
+Entity:: Entity(uint32_t ID, int scene, const std::string& name)
+{
+	this->ID = ID;
+	this->scene = scene;
+	this->nameID = ECS::main.registry.names.Intern(name);
+};
 
-	tHitNear = std::max(tNear.x, tNear.y);
-	float tHitFar = std::min(tFar.x, tFar.y);
+#pragma endregion
 
-	if (tHitFar < 0)
-	{
-		return false;
-	}
+#pragma region Body Stream
 
-	contactPoint = rayOrigin + tHitNear * rayDir;
+int BodyStream::Allocate(int scene)
+{
+	int slot;
 
-	if (tNear.x > tNear.y)
+	if (freeSlots.size() > 0)
 	{
-		if (invertDir.x < 0)
-		{
-			contactNormal = glm::vec2(1, 0);
-		}
-		else
-		{
-			contactNormal = glm::vec2(-1, 0);
-		}
+		slot = freeSlots.back();
+		freeSlots.pop_back();
 	}
 	else
 	{
-		if (invertDir.y < 0)
-		{
-			contactNormal = glm::vec2(0, 1);
-		}
-		else
+		if (end == chunks.size() * ChunkSize)
 		{
-			contactNormal = glm::vec2(0, -1);
+			chunks.push_back(new Chunk());
 		}
+
+		slot = end++;
 	}
 
-	/*Texture2D* t = Game::main.textureMap["blank"];
-	Game::main.renderer->prepareQuad(contactPoint, t->width, t->height, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f), t->ID);
-	Game::main.renderer->prepareQuad(contactPoint + contactNormal, t->width / 2.0f, t->height * 2.0f, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), t->ID);
-	Game::main.renderer->prepareQuad(rayOrigin + rayDir, t->width / 2.0f, t->height / 2.0f, glm::vec4(0.0f, 1.0f, 1.0f, 1.0f), t->ID);*/
+	Chunk& c = ChunkOf(slot);
+	int l = Lane(slot);
 
-	return true;
+	c.x[l] = 0;
+	c.y[l] = 0;
+	c.z[l] = 0;
+	c.rotation[l] = 0;
+	c.velocityX[l] = 0;
+	c.velocityY[l] = 0;
+	c.rotVelocity[l] = 0;
+	c.scene[l] = scene;
+	c.moving[l] = false;
+
+	return slot;
 }
 
-glm::vec2 lerp(glm::vec2 pos, glm::vec2 tar, float step)
+void BodyStream::Free(int slot)
 {
-	return (pos * (1.0f - step) + (tar * step));
+	Chunk& c = ChunkOf(slot);
+	int l = Lane(slot);
+
+	// Free slots still get walked by the integrator, so we make sure they can't go anywhere.
+	c.velocityX[l] = 0;
+	c.velocityY[l] = 0;
+	c.rotVelocity[l] = 0;
+	c.moving[l] = false;
+
+	freeSlots.push_back(slot);
 }
 
-float Dot(glm::vec2 a, glm::vec2 b)
+void BodyStream::Snapshot()
 {
-	return a.x * b.x + a.y * b.y;
+	for (int c = 0; c < chunks.size(); c++)
+	{
+		Chunk& chunk = *chunks[c];
+
+		std::copy(std::begin(chunk.x), std::end(chunk.x), std::begin(chunk.previousX));
+		std::copy(std::begin(chunk.y), std::end(chunk.y), std::begin(chunk.previousY));
+		std::copy(std::begin(chunk.rotation), std::end(chunk.rotation), std::begin(chunk.previousRotation));
+	}
 }
-#pragma endregion
 
-#pragma region Entities
+void BodyStream::Interpolate(float alpha)
+{
+	for (int c = 0; c < chunks.size(); c++)
+	{
+		Chunk& chunk = *chunks[c];
 
-int Entity::Get_ID() { return ID; }
-int Entity::Get_Scene() { return scene; }
-std::string Entity::Get_Name() { return name; }
+		for (int i = 0; i < ChunkSize; i++)
+		{
+			chunk.simulatedX[i] = chunk.x[i];
+			chunk.simulatedY[i] = chunk.y[i];
+			chunk.simulatedRotation[i] = chunk.rotation[i];
 
-void Entity::Set_ID(int newID) { ID = newID; }
-void Entity::Set_Scene(int newScene) { scene = newScene; }
-void Entity::Set_Name(std::string newName) { name = newName; }
+			if (chunk.moving[i])
+			{
+				chunk.x[i] = chunk.previousX[i] + (chunk.x[i] - chunk.previousX[i]) * alpha;
+				chunk.y[i] = chunk.previousY[i] + (chunk.y[i] - chunk.previousY[i]) * alpha;
+				chunk.rotation[i] = chunk.previousRotation[i] + (chunk.rotation[i] - chunk.previousRotation[i]) * alpha;
+			}
+		}
+	}
+}
 
-Entity:: Entity(int ID, int scene, std::string name)
+void BodyStream::Restore()
 {
-	this->ID = ID;
-	this->scene = scene;
-	this->name = name;
-};
+	for (int c = 0; c < chunks.size(); c++)
+	{
+		Chunk& chunk = *chunks[c];
+
+		for (int i = 0; i < ChunkSize; i++)
+		{
+			if (chunk.moving[i])
+			{
+				chunk.x[i] = chunk.simulatedX[i];
+				chunk.y[i] = chunk.simulatedY[i];
+				chunk.rotation[i] = chunk.simulatedRotation[i];
+			}
+		}
+	}
+}
 
 #pragma endregion
 
 #pragma region Component Blocks
 void ComponentBlock::Update(int activeScene, float deltaTime)
 {
+	ProfileScope scope(system->name);
 	system->Update(activeScene, deltaTime);
+	system->lastRun = Component::tick;
 }
 void ComponentBlock::AddComponent(Component* c)
 {
@@ -172,86 +226,193 @@ ComponentBlock::ComponentBlock(System* system, int componentID)
 #pragma endregion
 
 #pragma region ECS
-uint32_t ECS::GetID()
+EntityHandle ECS::GetID()
 {
-	return ++entityIDCounter;
+	uint32_t index;
+
+	if (freeSlots.size() > 0)
+	{
+		index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		index = slots.size();
+		slots.push_back(nullptr);
+		generations.push_back(1);
+	}
+
+	return EntityHandle(index, generations[index]);
+}
+
+Entity* ECS::GetEntity(EntityHandle handle)
+{
+	uint32_t index = handle.Index();
+
+	if (handle.value == 0 || index >= slots.size() || generations[index] != handle.Generation())
+	{
+		return nullptr;
+	}
+
+	return slots[index];
 }
 
 void ECS::Init()
 {
 	// I think we're going to have to initiate every component block
 	// at the beginning of the game. This might be long.
+	// Each system also says what it reads and writes, so the scheduler knows what it can run in parallel.
 
 	AISystem* aiSystem = new AISystem();
+	aiSystem->name = "ai";
+	aiSystem->Reads({ positionComponentID, colliderComponentID });
+	aiSystem->Writes({ aiComponentID });
 	ComponentBlock* aiBlock = new ComponentBlock(aiSystem, aiComponentID);
 	componentBlocks.push_back(aiBlock);
 
 	InputSystem* inputSystem = new InputSystem();
+	inputSystem->name = "input";
+	inputSystem->mainThread = true;
+	inputSystem->Reads({ healthComponentID, positionComponentID, cameraResourceID });
+	inputSystem->Writes({ inputComponentID, movementComponentID, physicsComponentID, colliderComponentID, bladeComponentID, damageComponentID, animationControllerComponentID, animationComponentID, particleResourceID, randomResourceID, windowResourceID });
 	ComponentBlock* inputBlock = new ComponentBlock(inputSystem, inputComponentID);
 	componentBlocks.push_back(inputBlock);
 
 	BladeSystem* bladeSystem = new BladeSystem();
+	bladeSystem->name = "blade";
+	bladeSystem->mainThread = true;
+	bladeSystem->Reads({ movementComponentID, cameraResourceID });
+	bladeSystem->Writes({ bladeComponentID, colliderComponentID, damageComponentID, physicsComponentID, positionComponentID, animationComponentID, particleResourceID, randomResourceID, windowResourceID });
 	ComponentBlock* bladeBlock = new ComponentBlock(bladeSystem, bladeComponentID);
 	componentBlocks.push_back(bladeBlock);
 
 	PhysicsSystem* physicsSystem = new PhysicsSystem();
+	physicsSystem->name = "physics";
+	physicsSystem->Reads({ positionComponentID, colliderComponentID, movementComponentID });
+	physicsSystem->Writes({ physicsComponentID });
 	ComponentBlock* physicsBlock = new ComponentBlock(physicsSystem, physicsComponentID);
 	componentBlocks.push_back(physicsBlock);
 
 	ParticleSystem* particleSystem = new ParticleSystem();
+	particleSystem->name = "particle";
+	particleSystem->Reads({ positionComponentID, cameraResourceID });
+	particleSystem->Writes({ particleComponentID, particleResourceID, randomResourceID });
 	ComponentBlock* particleBlock = new ComponentBlock(particleSystem, particleComponentID);
 	componentBlocks.push_back(particleBlock);
 
 	ColliderSystem* colliderSystem = new ColliderSystem();
+	colliderSystem->name = "collider";
+	colliderSystem->Writes({ colliderComponentID, physicsComponentID, positionComponentID, movementComponentID, healthComponentID, damageComponentID, particleResourceID, randomResourceID });
 	ComponentBlock* colliderBlock = new ComponentBlock(colliderSystem, colliderComponentID);
 	componentBlocks.push_back(colliderBlock);
 
 	DamageSystem* damageSystem = new DamageSystem();
+	damageSystem->name = "damage";
+	damageSystem->Writes({ damageComponentID });
 	ComponentBlock* damageBlock = new ComponentBlock(damageSystem, damageComponentID);
 	componentBlocks.push_back(damageBlock);
 
 	HealthSystem* healthSystem = new HealthSystem();
+	healthSystem->name = "health";
+	healthSystem->Writes({ healthComponentID });
 	ComponentBlock* healthBlock = new ComponentBlock(healthSystem, healthComponentID);
 	componentBlocks.push_back(healthBlock);
 
 	PositionSystem* positionSystem = new PositionSystem();
+	positionSystem->name = "position";
+	positionSystem->Reads({ physicsComponentID });
+	positionSystem->Writes({ positionComponentID });
 	ComponentBlock* positionBlock = new ComponentBlock(positionSystem, positionComponentID);
 	componentBlocks.push_back(positionBlock);
 
 	ImageSystem* imageSystem = new ImageSystem();
+	imageSystem->name = "image";
+	imageSystem->render = true;
+	imageSystem->Reads({ cameraResourceID });
+	imageSystem->Writes({ imageComponentID, positionComponentID, spriteComponentID });
 	ComponentBlock* imageBlock = new ComponentBlock(imageSystem, imageComponentID);
 	componentBlocks.push_back(imageBlock);
 
 	ButtonSystem* buttonSystem = new ButtonSystem();
+	buttonSystem->name = "button";
+	buttonSystem->render = true;
+	buttonSystem->mainThread = true;
+	buttonSystem->Reads({ positionComponentID, cameraResourceID });
+	buttonSystem->Writes({ buttonComponentID, spriteComponentID, windowResourceID });
 	ComponentBlock* buttonBlock = new ComponentBlock(buttonSystem, buttonComponentID);
 	componentBlocks.push_back(buttonBlock);
 
 	StaticRenderingSystem* renderingSystem = new StaticRenderingSystem();
+	renderingSystem->name = "static rendering";
+	renderingSystem->render = true;
+	renderingSystem->mainThread = true;
+	renderingSystem->Reads({ spriteComponentID, positionComponentID, cameraResourceID });
+	renderingSystem->Writes({ renderResourceID });
 	ComponentBlock* renderingBlock = new ComponentBlock(renderingSystem, spriteComponentID);
 	componentBlocks.push_back(renderingBlock);
 
 	CameraFollowSystem* camfollowSystem = new CameraFollowSystem();
+	camfollowSystem->name = "camera follow";
+	camfollowSystem->render = true;
+	camfollowSystem->Reads({ cameraFollowComponentID, positionComponentID });
+	camfollowSystem->Writes({ cameraResourceID });
 	ComponentBlock* camfollowBlock = new ComponentBlock(camfollowSystem, cameraFollowComponentID);
 	componentBlocks.push_back(camfollowBlock);
 
 	AnimationControllerSystem* animationControllerSystem = new AnimationControllerSystem();
+	animationControllerSystem->name = "animation controller";
+	animationControllerSystem->Reads({ colliderComponentID, healthComponentID, inputComponentID, movementComponentID, physicsComponentID });
+	animationControllerSystem->Writes({ animationControllerComponentID, animationComponentID });
 	ComponentBlock* animationControllerBlock = new ComponentBlock(animationControllerSystem, animationControllerComponentID);
 	componentBlocks.push_back(animationControllerBlock);
 
 	AnimationSystem* animationSystem = new AnimationSystem();
+	animationSystem->name = "animation";
+	animationSystem->render = true;
+	animationSystem->mainThread = true;
+	animationSystem->Reads({ positionComponentID, cameraResourceID });
+	animationSystem->Writes({ animationComponentID, renderResourceID });
 	ComponentBlock* animationBlock = new ComponentBlock(animationSystem, animationComponentID);
 	componentBlocks.push_back(animationBlock);
 
 	TextRenderingSystem* textSystem = new TextRenderingSystem();
+	textSystem->name = "text rendering";
+	textSystem->render = true;
+	textSystem->mainThread = true;
+	textSystem->Reads({ textComponentID, positionComponentID, cameraResourceID });
+	textSystem->Writes({ renderResourceID });
 	ComponentBlock* textBlock = new ComponentBlock(textSystem, textComponentID);
 	componentBlocks.push_back(textBlock);
+
+	for (int i = 0; i < componentBlocks.size(); i++)
+	{
+		int id = componentBlocks[i]->componentID;
+
+		if (id >= blocksByID.size())
+		{
+			blocksByID.resize(id + 1, nullptr);
+		}
+
+		blocksByID[id] = componentBlocks[i];
+	}
+
+	// We keep one core for everything else (the main thread helps out with the systems, too).
+	int workers = (int)std::thread::hardware_concurrency() - 1;
+	scheduler.Build(componentBlocks, (workers > 0) ? workers : 0);
 }
 
 void ECS::Update(float deltaTime)
 {
 	round++;
+	Component::tick++;
 
 	if (round == 1)
+	{
+		DefinePrefabs();
+	}
+
+	// The benchmark (see bench.cpp) builds its own worlds, so it turns this off.
+	if (round == 1 && loadLevel)
 	{
 		#pragma region UI Instantiation
 
@@ -259,37 +420,37 @@ void ECS::Update(float deltaTime)
 		Texture2D* watermark = Game::main.textureMap["watermark"];
 		Texture2D* watermarkMap = Game::main.textureMap["watermarkMap"];
 
-		ECS::main.RegisterComponent(new PositionComponent(alphaWatermark, true, true, 0, 0, 100, 0), alphaWatermark);
-		ECS::main.RegisterComponent(new StaticSpriteComponent(alphaWatermark, true, (PositionComponent*)alphaWatermark->componentIDMap[positionComponentID], watermark->width, watermark->height, 2.0f, 2.0f, watermark, watermarkMap, false, false, false, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)), alphaWatermark);
-		ECS::main.RegisterComponent(new ImageComponent(alphaWatermark, true, Anchor::topRight, 0, 0, watermark->width, watermark->height, 2.0f, 2.0f), alphaWatermark);
-		// ECS::main.RegisterComponent(new TextComponent(alphaWatermark, true, "test", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), 1.0f, 1.0f, 0, -50.0f, TextAlignment::center, 0, 0, 0, 0), alphaWatermark);
+		ECS::main.AddComponent<PositionComponent>(alphaWatermark, true, true, 0, 0, 100, 0);
+		ECS::main.AddComponent<StaticSpriteComponent>(alphaWatermark, true, alphaWatermark->Get<PositionComponent>(), watermark->width, watermark->height, 2.0f, 2.0f, watermark, watermarkMap, false, false, false, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+		ECS::main.AddComponent<ImageComponent>(alphaWatermark, true, Anchor::topRight, 0, 0, watermark->width, watermark->height, 2.0f, 2.0f);
+		// ECS::main.AddComponent<TextComponent>(alphaWatermark, true, "test", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), 1.0f, 1.0f, 0, -50.0f, TextAlignment::center, 0, 0, 0, 0);
 
 		#pragma endregion
 
 		#pragma region Moonlight Blade Instantiation
 
-		player = CreateEntity(0, "The Player");
+		Entity* lily = CreateEntity(0, "The Player");
+		player = lily->Get_Handle();
 		Entity* moonlightBlade = CreateEntity(0, "Moonlight Blade");
 		Animation2D* moonlightBladeIdle = Game::main.animationMap["moonlightBlade"];
 		Texture2D* moonlightBladeMap = Game::main.textureMap["moonlightBladeMap"];
 		Texture2D* moonlightBladeIncorporealMap = Game::main.textureMap["moonlightBladeIncorporealMap"];
 
-		ECS::main.RegisterComponent(new PositionComponent(moonlightBlade, true, false, 0, 0, -10.0f, 0.0f), moonlightBlade);
-		ECS::main.RegisterComponent(new PhysicsComponent(moonlightBlade, true, (PositionComponent*)moonlightBlade->componentIDMap[positionComponentID], 0.0f, 0.0f, 0.0f, 0.0f, 0.0f), moonlightBlade);
-		// ECS::main.RegisterComponent(new StaticSpriteComponent(moonlightBlade, true, (PositionComponent*)moonlightBlade->componentIDMap[positionComponentID], moonlightBladeTex->width, moonlightBladeTex->height, 1.0f, 1.0f, moonlightBladeTex, moonlightBladeMap, false, false, false), moonlightBlade);
-		ECS::main.RegisterComponent(new AnimationComponent(moonlightBlade, true, (PositionComponent*)moonlightBlade->componentIDMap[positionComponentID], moonlightBladeIdle, "idle", moonlightBladeMap, 0.5f, 0.5f, false, false), moonlightBlade);
-		AnimationComponent* aBlade = (AnimationComponent*)moonlightBlade->componentIDMap[animationComponentID];
-		ECS::main.RegisterComponent(new MoonlightBladeAnimationControllerComponent(moonlightBlade, true, aBlade), moonlightBlade);
-		// ECS::main.RegisterComponent(new AIComponent(moonlightBlade, true, false, 1010.0f, 1000.0f, 0.5f, 0.0f, 0.0f, AIType::moonlight_blade), moonlightBlade);
-		ECS::main.RegisterComponent(new ColliderComponent(moonlightBlade, false, (PositionComponent*)moonlightBlade->componentIDMap[positionComponentID], false, false, true, false, true, false, true, EntityClass::object, 1.0f, 0.0f, 0.0f, 5.0f, 5.0f, 0.0f, 0.0f), moonlightBlade);
-		ECS::main.RegisterComponent(new DamageComponent(moonlightBlade, true, player, false, 0.0f, true, false, 100, 20.0f, false, true, true, true), moonlightBlade);
+		ECS::main.AddComponent<PositionComponent>(moonlightBlade, true, false, 0, 0, -10.0f, 0.0f);
+		ECS::main.AddComponent<PhysicsComponent>(moonlightBlade, true, moonlightBlade->Get<PositionComponent>(), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+		// ECS::main.AddComponent<StaticSpriteComponent>(moonlightBlade, true, moonlightBlade->Get<PositionComponent>(), moonlightBladeTex->width, moonlightBladeTex->height, 1.0f, 1.0f, moonlightBladeTex, moonlightBladeMap, false, false, false);
+		ECS::main.AddComponent<AnimationComponent>(moonlightBlade, true, moonlightBlade->Get<PositionComponent>(), moonlightBladeIdle, "idle", moonlightBladeMap, 0.5f, 0.5f, false, false);
+		AnimationComponent* aBlade = moonlightBlade->Get<AnimationComponent>();
+		ECS::main.AddComponent<MoonlightBladeAnimationControllerComponent>(moonlightBlade, true, aBlade);
+		// ECS::main.AddComponent<AIComponent>(moonlightBlade, true, false, 1010.0f, 1000.0f, 0.5f, 0.0f, 0.0f, AIType::moonlight_blade);
+		ECS::main.AddComponent<ColliderComponent>(moonlightBlade, false, moonlightBlade->Get<PositionComponent>(), false, false, true, false, true, false, true, EntityClass::object, 1.0f, 0.0f, 0.0f, 5.0f, 5.0f, 0.0f, 0.0f);
+		ECS::main.AddComponent<DamageComponent>(moonlightBlade, true, player, false, 0.0f, true, false, 100, 20.0f, false, true, true, true);
 
 		Entity* hilt = CreateEntity(0, "Moonlight Blade Hilt");
-		ECS::main.RegisterComponent(new PositionComponent(hilt, true, false, 0, 0, 0, 0.0f), hilt);
-		ECS::main.RegisterComponent(new PhysicsComponent(hilt, true, (PositionComponent*)hilt->componentIDMap[positionComponentID], 0.0f, 0.0f, 0.0f, 0.0f, 0.0f), hilt);
-		ColliderComponent* platformCollider = new ColliderComponent(hilt, false, (PositionComponent*)hilt->componentIDMap[positionComponentID], true, true, true, false, false, false, false, EntityClass::object, 1.0f, 0.0f, 0.0f, 35.0f, 5.0f, 0.0f, 0.0f);
-		ECS::main.RegisterComponent(platformCollider, hilt);
-		ECS::main.RegisterComponent(new BladeComponent(moonlightBlade, true, 1010.0f, 1000.0f, 0.5f, 1000.0f, platformCollider, moonlightBladeMap, moonlightBladeIncorporealMap, 0.5f), moonlightBlade);
+		ECS::main.AddComponent<PositionComponent>(hilt, true, false, 0, 0, 0, 0.0f);
+		ECS::main.AddComponent<PhysicsComponent>(hilt, true, hilt->Get<PositionComponent>(), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+		ECS::main.AddComponent<ColliderComponent>(hilt, false, hilt->Get<PositionComponent>(), true, true, true, false, false, false, false, EntityClass::object, 1.0f, 0.0f, 0.0f, 35.0f, 5.0f, 0.0f, 0.0f);
+		ECS::main.AddComponent<BladeComponent>(moonlightBlade, true, 1010.0f, 1000.0f, 0.5f, 1000.0f, hilt->Get_Handle(), moonlightBladeMap, moonlightBladeIncorporealMap, 0.5f);
 
 		#pragma endregion
 
@@ -297,16 +458,16 @@ void ECS::Update(float deltaTime)
 		Texture2D* lilyMap = Game::main.textureMap["lilyMap"];
 		Animation2D* anim1 = Game::main.animationMap["baseIdle"];
 
-		ECS::main.RegisterComponent(new PositionComponent(player, true, false, 0, 100, 0, 0.0f), player);
-		ECS::main.RegisterComponent(new PhysicsComponent(player, true, (PositionComponent*)player->componentIDMap[positionComponentID], 0.0f, 0.0f, 0.0f, 5000.0f, 2000.0f), player);
-		ECS::main.RegisterComponent(new ColliderComponent(player, true, (PositionComponent*)player->componentIDMap[positionComponentID], false, false, false, false, false, true, false, EntityClass::player, 1.0f, 1.0f, 10.0f, 20.0f, 50.0f, 0.0f, -7.75f), player);
-		ECS::main.RegisterComponent(new MovementComponent(player, true, true, 4000.0f, 500.0f, 2.5f, 0.5f, 0.7f, true, false, 0.5f), player);
-		ECS::main.RegisterComponent(new InputComponent(player, true, moonlightBlade, true, 0.5f, 2, 0.5f, lilyMap), player);
-		ECS::main.RegisterComponent(new CameraFollowComponent(player, true, 10.0f, false, false), player);
-		ECS::main.RegisterComponent(new HealthComponent(player, true, 1000.0f, false), player);
-		ECS::main.RegisterComponent(new AnimationComponent(player, true, (PositionComponent*)player->componentIDMap[positionComponentID], anim1, "idle", lilyMap, 1.0f, 1.0f, false, false), player);
-		AnimationComponent* a = (AnimationComponent*)player->componentIDMap[animationComponentID];
-		ECS::main.RegisterComponent(new PlayerAnimationControllerComponent(player, true, a), player);
+		ECS::main.AddComponent<PositionComponent>(lily, true, false, 0, 100, 0, 0.0f);
+		ECS::main.AddComponent<PhysicsComponent>(lily, true, lily->Get<PositionComponent>(), 0.0f, 0.0f, 0.0f, 5000.0f, 2000.0f);
+		ECS::main.AddComponent<ColliderComponent>(lily, true, lily->Get<PositionComponent>(), false, false, false, false, false, true, false, EntityClass::player, 1.0f, 1.0f, 10.0f, 20.0f, 50.0f, 0.0f, -7.75f);
+		ECS::main.AddComponent<MovementComponent>(lily, true, true, 4000.0f, 500.0f, 2.5f, 0.5f, 0.7f, true, false, 0.5f);
+		ECS::main.AddComponent<InputComponent>(lily, true, moonlightBlade->Get_Handle(), true, 0.5f, 2, 0.5f, lilyMap);
+		ECS::main.AddComponent<CameraFollowComponent>(lily, true, 10.0f, false, false);
+		ECS::main.AddComponent<HealthComponent>(lily, true, 1000.0f, false);
+		ECS::main.AddComponent<AnimationComponent>(lily, true, lily->Get<PositionComponent>(), anim1, "idle", lilyMap, 1.0f, 1.0f, false, false);
+		AnimationComponent* a = lily->Get<AnimationComponent>();
+		ECS::main.AddComponent<PlayerAnimationControllerComponent>(lily, true, a);
 
 		a->AddAnimation("walk", Game::main.animationMap["baseWalk"]);
 		a->AddAnimation("crouch", Game::main.animationMap["baseCrouch"]);
@@ -324,50 +485,174 @@ void ECS::Update(float deltaTime)
 		/*Texture2D* wallTex = Game::main.textureMap["wall"];
 		Texture2D* wallTexMap = Game::main.textureMap["wallMap"];
 		Entity* wall = CreateEntity(0, "wall");
-		ECS::main.RegisterComponent(new PositionComponent(wall, true, true, 0, 0, -100, 0.0f), wall);
-		ECS::main.RegisterComponent(new StaticSpriteComponent(wall, true, (PositionComponent*)wall->componentIDMap[positionComponentID], wallTex->width, wallTex->height, 1000.0f, 1000.0f, wallTex, wallTexMap, false, false, true), wall);*/
+		ECS::main.AddComponent<PositionComponent>(wall, true, true, 0, 0, -100, 0.0f);
+		ECS::main.AddComponent<StaticSpriteComponent>(wall, true, wall->Get<PositionComponent>(), wallTex->width, wallTex->height, 1000.0f, 1000.0f, wallTex, wallTexMap, false, false, true);*/
 
-		Texture2D* tex3 = Game::main.textureMap["blank"];
-		Texture2D* tex3Map = Game::main.textureMap["base_map"];
+		Prefab* floorPrefab = GetPrefab("floor");
+
+		PrefabInstance platforms[25];
 
 		for (int i = 0; i < 25; i++)
 		{
 			float width = rand() % 1000 + 300;
 			float height = rand() % 1000 + 300;
 
-			Entity* platform = CreateEntity(0, "floor");
-			ECS::main.RegisterComponent(new PositionComponent(platform, true, true, rand() % 5000, rand() % 5000, 0, 0), platform);
-			ECS::main.RegisterComponent(new PhysicsComponent(platform, true, (PositionComponent*)platform->componentIDMap[positionComponentID], 0.0f, 0.0f, 0.0f, 0.1f, 0.0f), platform);
-			ECS::main.RegisterComponent(new ColliderComponent(platform, true, (PositionComponent*)platform->componentIDMap[positionComponentID], true, false, false, true, false, false, false, EntityClass::object, 1000.0f, 0.0f, 1.0f, width, height, 0.0f, 0.0f), platform);
-			ECS::main.RegisterComponent(new StaticSpriteComponent(platform, true, (PositionComponent*)platform->componentIDMap[positionComponentID], width, height, 1.0f, 1.0f, tex3, tex3Map, false, false, false, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)), platform);
+			platforms[i].size = glm::vec2(width, height);
+			platforms[i].position = glm::vec3(rand() % 5000, rand() % 5000, 0);
 		}
 
+		floorPrefab->Instantiate(25, platforms);
+
+		PrefabInstance floors[50];
+
 		for (int i = 0; i < 50; i++)
 		{
-			Entity* floor = CreateEntity(0, "floor");
-			ECS::main.RegisterComponent(new PositionComponent(floor, true, true, i * 500, -200, 0, 0.0f), floor);
-			ECS::main.RegisterComponent(new PhysicsComponent(floor, true, (PositionComponent*)floor->componentIDMap[positionComponentID], 0.0f, 0.0f, 0.0f, 0.1f, 0.0f), floor);
-			ECS::main.RegisterComponent(new ColliderComponent(floor, true, (PositionComponent*)floor->componentIDMap[positionComponentID], true, false, false, true, false, false, false, EntityClass::object, 1000.0f, 0.0f, 1.0f, 540.0f, 80.0f, 0.0f, 0.0f), floor);
-			ECS::main.RegisterComponent(new StaticSpriteComponent(floor, true, (PositionComponent*)floor->componentIDMap[positionComponentID], 540.0f, 80.0f, 1.0f, 1.0f, tex3, tex3Map, false, false, false, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)), floor);
+			floors[i].size = glm::vec2(540.0f, 80.0f);
+			floors[i].position = glm::vec3(i * 500, -200, 0);
 
 			/*Entity* earth = CreateEntity(0, "floor");
-			ECS::main.RegisterComponent(new PositionComponent(earth, true, true, i * 500, -1000, 0, 0.0f), earth);
-			ECS::main.RegisterComponent(new StaticSpriteComponent(earth, true, (PositionComponent*)earth->componentIDMap[positionComponentID], tex3->width * 35, tex3->height * 100.0f, 1.0f, 1.0f, tex3, tex3Map, false, false, false), earth);*/
+			ECS::main.AddComponent<PositionComponent>(earth, true, true, i * 500, -1000, 0, 0.0f);
+			ECS::main.AddComponent<StaticSpriteComponent>(earth, true, earth->Get<PositionComponent>(), tex3->width * 35, tex3->height * 100.0f, 1.0f, 1.0f, tex3, tex3Map, false, false, false);*/
 		}
+
+		floorPrefab->Instantiate(50, floors);
 	}
 
-	for (int i = 0; i < componentBlocks.size(); i++)
+	// The simulation runs in fixed steps, however many fit in the time that's passed; if we've fallen too far behind
+	// to catch up in maxSteps, we drop the rest rather than spending even longer on the next frame trying.
+	accumulator += deltaTime;
+	int steps = 0;
+
+	while (accumulator >= fixedStep && steps < maxSteps)
 	{
-		componentBlocks[i]->Update(activeScene, deltaTime);
+		ProfileScope scope("simulation step");
+
+		BodyStream::main.Snapshot();
+		scheduler.Run(activeScene, fixedStep, false);
+
+		PlaybackCommands();
+		PurgeDeadEntities();
+
+		accumulator -= fixedStep;
+		steps++;
+	}
+
+	if (steps == maxSteps)
+	{
+		accumulator = std::min(accumulator, fixedStep);
 	}
 
+	// Then everything that's moving is drawn however far we are between the last step and the next one.
+	interpolation = accumulator / fixedStep;
+
+	ProfileScope scope("render systems");
+
+	BodyStream::main.Interpolate(interpolation);
+	scheduler.Run(activeScene, deltaTime, true);
+	BodyStream::main.Restore();
+
+	PlaybackCommands();
 	PurgeDeadEntities();
 }
 
+void ECS::SetSimulationRate(float stepsPerSecond, int maxSteps)
+{
+	fixedStep = 1.0f / stepsPerSecond;
+	this->maxSteps = maxSteps;
+}
+
+Prefab* ECS::DefinePrefab(std::string name, int scene)
+{
+	Prefab* prefab = new Prefab(name, scene);
+	prefabs[name] = prefab;
+	return prefab;
+}
+
+Prefab* ECS::GetPrefab(std::string name)
+{
+	auto p = prefabs.find(name);
+	return (p != prefabs.end()) ? p->second : nullptr;
+}
+
+void ECS::DefinePrefabs()
+{
+	// This has to wait until the textures are loaded, which is why it isn't in Init().
+
+	#pragma region Aether Bullet
+
+	Texture2D* bulletTex = Game::main.textureMap["bullet"];
+	Texture2D* bulletMap = Game::main.textureMap["aether_bullet"];
+
+	// Bullets only last a few seconds, so they get recycled rather than torn down; a few dozen is about what a busy fight keeps alive.
+	Prefab* bullet = DefinePrefab("aether bullet", 0);
+
+	bullet->Recycle().
+		With<PositionComponent>([](Entity* e, const PrefabInstance& in)
+			{
+				ECS::main.AddComponent<PositionComponent>(e, true, false, in.position.x, in.position.y, in.position.z, in.rotation);
+			}).
+		With<PhysicsComponent>([](Entity* e, const PrefabInstance& in)
+			{
+				ECS::main.AddComponent<PhysicsComponent>(e, true, e->Get<PositionComponent>(), in.velocity.x, in.velocity.y, 0.0f, 0.0f, 0.0f);
+			}).
+		With<ColliderComponent>([](Entity* e, const PrefabInstance& in)
+			{
+				ECS::main.AddComponent<ColliderComponent>(e, true, e->Get<PositionComponent>(), false, false, true, false, true, false, true, EntityClass::object, 1.0f, 0.0f, 0.0f, 5.0f, 5.0f, 0.0f, 0.0f);
+			}).
+		With<DamageComponent>([](Entity* e, const PrefabInstance& in)
+			{
+				ECS::main.AddComponent<DamageComponent>(e, true, in.owner, true, 10.0f, false, true, 1, 10.0f, true, true, true, false);
+			}).
+		With<StaticSpriteComponent>([bulletTex, bulletMap](Entity* e, const PrefabInstance& in)
+			{
+				ECS::main.AddComponent<StaticSpriteComponent>(e, true, e->Get<PositionComponent>(), bulletTex->width, bulletTex->height, 1.0f, 1.0f, bulletTex, bulletMap, false, false, false, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+			});
+
+	bullet->Prewarm(64);
+
+	#pragma endregion
+
+	#pragma region Floor
+
+	// Floors (and platforms) come in all different sizes, so their width and height come from the instance.
+	Texture2D* floorTex = Game::main.textureMap["blank"];
+	Texture2D* floorMap = Game::main.textureMap["base_map"];
+
+	DefinePrefab("floor", 0)->
+		With<PositionComponent>([](Entity* e, const PrefabInstance& in)
+			{
+				ECS::main.AddComponent<PositionComponent>(e, true, true, in.position.x, in.position.y, in.position.z, in.rotation);
+			}).
+		With<PhysicsComponent>([](Entity* e, const PrefabInstance& in)
+			{
+				ECS::main.AddComponent<PhysicsComponent>(e, true, e->Get<PositionComponent>(), 0.0f, 0.0f, 0.0f, 0.1f, 0.0f);
+			}).
+		With<ColliderComponent>([](Entity* e, const PrefabInstance& in)
+			{
+				ECS::main.AddComponent<ColliderComponent>(e, true, e->Get<PositionComponent>(), true, false, false, true, false, false, false, EntityClass::object, 1000.0f, 0.0f, 1.0f, in.size.x, in.size.y, 0.0f, 0.0f);
+			}).
+		With<StaticSpriteComponent>([floorTex, floorMap](Entity* e, const PrefabInstance& in)
+			{
+				ECS::main.AddComponent<StaticSpriteComponent>(e, true, e->Get<PositionComponent>(), in.size.x, in.size.y, 1.0f, 1.0f, floorTex, floorMap, false, false, false, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+			});
+
+	#pragma endregion
+}
+
 void ECS::AddDeadEntity(Entity* e)
 {
-	if (std::find(dyingEntities.begin(), dyingEntities.end(), e) == dyingEntities.end())
+	std::lock_guard<std::mutex> guard(dyingLock);
+
+	uint32_t index = e->Get_Handle().Index();
+
+	if (index >= dying.size())
+	{
+		dying.resize(slots.size(), false);
+	}
+
+	if (!dying[index])
 	{
+		dying[index] = true;
 		dyingEntities.push_back(e);
 	}
 }
@@ -378,8 +663,16 @@ void ECS::PurgeDeadEntities()
 	{
 		int n = dyingEntities.size();
 
+		// Systems running in parallel can add to this list in whatever order they happen to finish,
+		// so we go through it in slot order to keep things the same from run to run.
+		std::sort(dyingEntities.begin(), dyingEntities.end(), [](Entity* a, Entity* b)
+			{
+				return a->Get_Handle().Index() < b->Get_Handle().Index();
+			});
+
 		for (int i = 0; i < n; i++)
 		{
+			dying[dyingEntities[i]->Get_Handle().Index()] = false;
 			DeleteEntity(dyingEntities[i]);
 		}
 
@@ -389,107 +682,443 @@ void ECS::PurgeDeadEntities()
 
 Entity* ECS::CreateEntity(int scene, std::string name)
 {
-	Entity* e = new Entity(GetID(), scene, name);
+	EntityHandle handle = GetID();
+	Entity*& e = slots[handle.Index()];
+
+	if (e == nullptr)
+	{
+		e = new Entity(handle.value, scene, name);
+	}
+	else
+	{
+		// This slot held an entity before, so we just reuse it.
+		e->Set_ID(handle.value);
+		e->Set_Scene(scene);
+		e->Set_Name(name);
+		e->prefab = nullptr;
+	}
+
+	registry.Add(e);
 	return e;
 }
 
 void ECS::DeleteEntity(Entity* e)
 {
-	for (int i = 0; i < componentBlocks.size(); i++)
+	// Recycled prefabs hold onto their dead, rather than tearing them down (see prefab.h).
+	if (e->prefab != nullptr)
 	{
-		componentBlocks[i]->PurgeEntity(e);
+		e->prefab->Park(e);
+		return;
 	}
 
-	delete e;
-}
+	registry.Remove(e);
 
-void ECS::RegisterComponent(Component* component, Entity* entity)
-{
-	entity->components.push_back(component);
-	entity->componentIDMap.emplace(component->ID, component);
+	for (int i = 0; i < views.size(); i++)
+	{
+		if ((e->componentMask & views[i]->mask) == views[i]->mask)
+		{
+			views[i]->Remove(e);
+		}
+	}
 
-	for (int i = 0; i < componentBlocks.size(); i++)
+	// We only bother the systems that actually hold one of the entity's components.
+	uint32_t mask = e->componentMask;
+
+	for (int id = 0; mask != 0; id++, mask >>= 1)
 	{
-		if (componentBlocks[i]->componentID == component->ID)
+		if ((mask & 1) && id < blocksByID.size() && blocksByID[id] != nullptr)
 		{
-			componentBlocks[i]->AddComponent(component);
-			return;
+			blocksByID[id]->PurgeEntity(e);
 		}
 	}
-}
-#pragma endregion
 
-#pragma region Components
+	// Movement components don't have a system of their own, so nobody else is going to give them back.
+	if (e->componentMask & (1u << movementComponentID))
+	{
+		Pool<MovementComponent>().Destroy(e->Get<MovementComponent>());
+	}
 
-#pragma region Position Component
+	e->componentMask = 0;
 
-glm::vec2 PositionComponent::Rotate(glm::vec2 point)
+	e->components.clear();
+	std::fill(std::begin(e->componentsByID), std::end(e->componentsByID), nullptr);
+
+	uint32_t index = e->Get_Handle().Index();
+	Retire(index);
+	freeSlots.push_back(index);
+}
+
+void ECS::Retire(uint32_t index)
 {
-	glm::vec3 forward = glm::vec3();
-	glm::vec3 up = glm::vec3();
-	glm::vec3 right = glm::vec3();
+	// The generation only has so many bits, so it wraps around (skipping zero, which we use for "no entity").
+	uint32_t generation = (generations[index] + 1) & ((1u << (32 - EntityHandle::indexBits)) - 1);
+	generations[index] = (generation == 0) ? 1 : generation;
+}
 
-	if (rotation != 0)
+void ECS::ParkEntity(Entity* e)
+{
+	// Anything the entity picked up that the prefab doesn't know about gets taken off the usual way,
+	// so that the next spawn starts with exactly the prefab's components.
+	uint32_t extra = e->componentMask & ~e->prefab->mask;
+
+	for (int id = 0; extra != 0; id++, extra >>= 1)
 	{
-		float radians = rotation * (M_PI / 180.0f);
+		if (extra & 1)
+		{
+			RemoveComponent(e, id);
+		}
+	}
 
-		forward = glm::vec3(0, 0, 1);
-		right = glm::vec3(cos(radians), sin(radians), 0);
-		up = glm::cross(forward, right);
+	for (int i = 0; i < views.size(); i++)
+	{
+		if ((e->componentMask & views[i]->mask) == views[i]->mask)
+		{
+			views[i]->Remove(e);
+		}
 	}
-	else
+
+	// The components stay in their systems' lists; the systems skip inactive ones.
+	for (int i = 0; i < e->components.size(); i++)
 	{
-		up = glm::vec3(0, 1, 0);
-		right = glm::vec3(1, 0, 0);
+		e->components[i]->active = false;
 	}
 
-	return RelativeLocation(point, up, right);
+	if (e->Has<PositionComponent>())
+	{
+		PositionComponent* pos = e->Get<PositionComponent>();
+		BodyStream::main.ChunkOf(pos->slot).moving[BodyStream::main.Lane(pos->slot)] = false;
+	}
+
+	// Parked colliders would otherwise sit in the broadphase (where they were when they died) and turn up in every query around there.
+	if (e->Has<ColliderComponent>())
+	{
+		((ColliderSystem*)blocksByID[colliderComponentID]->system)->DropProxy(e->Get<ColliderComponent>());
+	}
+
+	registry.Remove(e);
+
+	// The slot doesn't go back on the free list, since the entity's still in it.
+	Retire(e->Get_Handle().Index());
+	e->parked = true;
 }
 
-glm::vec2 PositionComponent::RelativeLocation(glm::vec2 p, glm::vec2 up, glm::vec2 right)
+void ECS::ReviveEntity(Entity* e)
 {
-	return glm::vec2((p.x * right.x) + (p.y * up.x), (p.x * right.y) + (p.y * up.y));
+	uint32_t index = e->Get_Handle().Index();
+	e->Set_ID(EntityHandle(index, generations[index]).value);
 }
 
-PositionComponent::PositionComponent(Entity* entity, bool active, bool stat, float x, float y, float z, float rotation)
+void ECS::UnparkEntity(Entity* e)
 {
-	ID = positionComponentID;
-	this->active = active;
-	this->entity = entity;
-	this->stat = stat;
-	this->x = x;
-	this->y = y;
-	this->z = z;
-	this->rotation = rotation;
-}
-#pragma endregion
+	e->parked = false;
+	registry.Add(e);
 
-#pragma region Physics Component
+	for (int i = 0; i < views.size(); i++)
+	{
+		if ((e->componentMask & views[i]->mask) == views[i]->mask)
+		{
+			views[i]->Add(e);
+		}
+	}
+}
 
-PhysicsComponent::PhysicsComponent(Entity* entity, bool active, PositionComponent* pos, float vX, float vY, float vR, float drag, float gravityMod)
+bool ECS::RegisterComponent(Component* component, Entity* entity)
 {
-	ID = physicsComponentID;
-	this->active = active;
-	this->entity = entity;
-	this->pos = pos;
+	// An entity only ever gets one component of each type; when it dies, that's the one its systems will purge,
+	// so a second one would never be purged (and would outlive the entity in its system's list).
+	if (entity->componentsByID[component->ID] != nullptr)
+	{
+		DuplicateComponent(entity, component->ID);
+		return false;
+	}
 
-	this->velocityX = vX;
-	this->velocityY = vY;
-	this->rotVelocity = vR;
-	this->drag = drag;
-	this->baseDrag = drag;
-	this->gravityMod = gravityMod;
-	this->baseGravityMod = gravityMod;
-}
+	uint32_t before = entity->componentMask;
 
-#pragma endregion
+	entity->components.push_back(component);
+	entity->componentsByID[component->ID] = component;
+	entity->componentMask |= (1u << component->ID);
 
-#pragma region Static Sprite Component
+	// If this was the last component some view was waiting on, the entity joins it
+	// (parked entities join their views all at once when they're unparked).
+	for (int i = 0; i < views.size() && !entity->parked; i++)
+	{
+		uint32_t m = views[i]->mask;
 
-StaticSpriteComponent::StaticSpriteComponent(Entity* entity, bool active, PositionComponent* pos, float width, float height, float scaleX, float scaleY, Texture2D* sprite, Texture2D* mapTex, bool flippedX, bool flippedY, bool tiled, glm::vec4 color)
-{
-	ID = spriteComponentID;
-	this->active = active;
+		if ((before & m) != m && (entity->componentMask & m) == m)
+		{
+			views[i]->Add(entity);
+		}
+	}
+
+	if (component->ID < blocksByID.size() && blocksByID[component->ID] != nullptr)
+	{
+		blocksByID[component->ID]->AddComponent(component);
+	}
+
+	return true;
+}
+
+void ECS::DuplicateComponent(Entity* entity, int componentID)
+{
+	std::cerr << "Entity \"" + entity->Get_Name() + "\" already has a component with ID " + std::to_string(componentID) + ", so it isn't getting another one\n";
+}
+
+void ECS::SetActiveScene(int scene)
+{
+	activeScene = scene;
+}
+
+void ECS::RemoveComponent(Entity* entity, int componentID)
+{
+	Component* component = entity->componentsByID[componentID];
+
+	if (component == nullptr)
+	{
+		return;
+	}
+
+	uint32_t before = entity->componentMask;
+	uint32_t after = before & ~(1u << componentID);
+
+	for (int i = 0; i < views.size(); i++)
+	{
+		uint32_t m = views[i]->mask;
+
+		if ((before & m) == m && (after & m) != m)
+		{
+			views[i]->Remove(entity);
+		}
+	}
+
+	// The systems' purge functions look the component up on the entity, so we have to take it off afterwards.
+	if (componentID < blocksByID.size() && blocksByID[componentID] != nullptr)
+	{
+		blocksByID[componentID]->PurgeEntity(entity);
+	}
+	else if (componentID == movementComponentID)
+	{
+		Pool<MovementComponent>().Destroy(entity->Get<MovementComponent>());
+	}
+
+	entity->componentsByID[componentID] = nullptr;
+	entity->componentMask = after;
+	entity->components.erase(std::remove(entity->components.begin(), entity->components.end(), component), entity->components.end());
+}
+
+EntityCommandBuffer& ECS::Commands()
+{
+	static thread_local EntityCommandBuffer* buffer = nullptr;
+
+	if (buffer == nullptr)
+	{
+		std::lock_guard<std::mutex> guard(commandLock);
+
+		buffer = new EntityCommandBuffer();
+		commandBuffers.push_back(buffer);
+	}
+
+	return *buffer;
+}
+
+void ECS::PlaybackCommands()
+{
+	// We pull everything out of the buffers first, so that anything recorded during playback waits for the next one.
+	static vector<EntityCommand> playback;
+	playback.clear();
+
+	for (int i = 0; i < commandBuffers.size(); i++)
+	{
+		EntityCommandBuffer* b = commandBuffers[i];
+
+		for (int j = 0; j < b->commands.size(); j++)
+		{
+			playback.push_back(std::move(b->commands[j]));
+		}
+
+		b->commands.clear();
+		b->sequence = 0;
+	}
+
+	std::sort(playback.begin(), playback.end(), [](const EntityCommand& a, const EntityCommand& b)
+		{
+			return (a.system != b.system) ? a.system < b.system : a.sequence < b.sequence;
+		});
+
+	// If a bunch of copies of the same prefab are on their way, we make room for all of them up front.
+	static map<Prefab*, int> batches;
+	batches.clear();
+
+	for (int i = 0; i < playback.size(); i++)
+	{
+		if (playback[i].prefab != nullptr)
+		{
+			batches[playback[i].prefab]++;
+		}
+	}
+
+	for (auto& batch : batches)
+	{
+		batch.first->Reserve(batch.second);
+	}
+
+	for (int i = 0; i < playback.size(); i++)
+	{
+		EntityCommand& c = playback[i];
+
+		if (c.type == EntityCommand::Type::create)
+		{
+			Entity* e = (c.prefab != nullptr) ? c.prefab->Acquire() : CreateEntity(c.scene, c.name);
+
+			if (c.apply)
+			{
+				c.apply(e);
+			}
+		}
+		else
+		{
+			// Whatever this was meant for might have died since it was recorded.
+			Entity* e = GetEntity(c.target);
+
+			if (e == nullptr)
+			{
+				continue;
+			}
+
+			if (c.type == EntityCommand::Type::modify)
+			{
+				c.apply(e);
+			}
+			else
+			{
+				AddDeadEntity(e);
+			}
+		}
+	}
+}
+
+ViewBase* ECS::AddView(ViewBase* view)
+{
+	std::lock_guard<std::mutex> guard(viewLock);
+
+	views.push_back(view);
+
+	for (int i = 0; i < slots.size(); i++)
+	{
+		// Dead entities have empty masks, so they'll never match (and parked ones are left for UnparkEntity).
+		if (slots[i] != nullptr && !slots[i]->parked && (slots[i]->componentMask & view->mask) == view->mask)
+		{
+			view->Add(slots[i]);
+		}
+	}
+
+	return view;
+}
+#pragma endregion
+
+#pragma region Components
+
+#pragma region Position Component
+
+glm::vec2 PositionComponent::Rotate(glm::vec2 point)
+{
+	glm::vec3 forward = glm::vec3();
+	glm::vec3 up = glm::vec3();
+	glm::vec3 right = glm::vec3();
+
+	if (rotation != 0)
+	{
+		float radians = rotation * (M_PI / 180.0f);
+
+		forward = glm::vec3(0, 0, 1);
+		right = glm::vec3(cos(radians), sin(radians), 0);
+		up = glm::cross(forward, right);
+	}
+	else
+	{
+		up = glm::vec3(0, 1, 0);
+		right = glm::vec3(1, 0, 0);
+	}
+
+	return RelativeLocation(point, up, right);
+}
+
+glm::vec2 PositionComponent::RelativeLocation(glm::vec2 p, glm::vec2 up, glm::vec2 right)
+{
+	return glm::vec2((p.x * right.x) + (p.y * up.x), (p.x * right.y) + (p.y * up.y));
+}
+
+PositionComponent::PositionComponent(Entity* entity, bool active, bool stat, float x, float y, float z, float rotation) :
+	slot(BodyStream::main.Allocate(entity->Get_Scene())),
+	x(BodyStream::main.ChunkOf(slot).x[BodyStream::main.Lane(slot)]),
+	y(BodyStream::main.ChunkOf(slot).y[BodyStream::main.Lane(slot)]),
+	z(BodyStream::main.ChunkOf(slot).z[BodyStream::main.Lane(slot)]),
+	rotation(BodyStream::main.ChunkOf(slot).rotation[BodyStream::main.Lane(slot)])
+{
+	ID = positionComponentID;
+	this->active = active;
+	this->entity = entity;
+	this->stat = stat;
+	this->x = x;
+	this->y = y;
+	this->z = z;
+	this->rotation = rotation;
+
+	// Otherwise, the first frame it's drawn, it would be drawn partway between here and wherever the slot's last owner was.
+	BodyStream::Chunk& chunk = BodyStream::main.ChunkOf(slot);
+	int lane = BodyStream::main.Lane(slot);
+	chunk.previousX[lane] = x;
+	chunk.previousY[lane] = y;
+	chunk.previousRotation[lane] = rotation;
+}
+
+PositionComponent::~PositionComponent()
+{
+	BodyStream::main.Free(slot);
+}
+#pragma endregion
+
+#pragma region Physics Component
+
+PhysicsComponent::PhysicsComponent(Entity* entity, bool active, PositionComponent* pos, float vX, float vY, float vR, float drag, float gravityMod) :
+	velocityX(BodyStream::main.ChunkOf(pos->slot).velocityX[BodyStream::main.Lane(pos->slot)]),
+	velocityY(BodyStream::main.ChunkOf(pos->slot).velocityY[BodyStream::main.Lane(pos->slot)]),
+	rotVelocity(BodyStream::main.ChunkOf(pos->slot).rotVelocity[BodyStream::main.Lane(pos->slot)])
+{
+	ID = physicsComponentID;
+	this->active = active;
+	this->entity = entity;
+	this->pos = pos;
+	this->slot = pos->slot;
+
+	// From here on, the position system will move this position along with our velocity.
+	BodyStream::main.ChunkOf(pos->slot).moving[BodyStream::main.Lane(pos->slot)] = pos->active;
+
+	this->velocityX = vX;
+	this->velocityY = vY;
+	this->rotVelocity = vR;
+	this->drag = drag;
+	this->baseDrag = drag;
+	this->gravityMod = gravityMod;
+	this->baseGravityMod = gravityMod;
+}
+
+PhysicsComponent::~PhysicsComponent()
+{
+	velocityX = 0;
+	velocityY = 0;
+	rotVelocity = 0;
+
+	BodyStream::main.ChunkOf(slot).moving[BodyStream::main.Lane(slot)] = false;
+}
+
+#pragma endregion
+
+#pragma region Static Sprite Component
+
+StaticSpriteComponent::StaticSpriteComponent(Entity* entity, bool active, PositionComponent* pos, float width, float height, float scaleX, float scaleY, Texture2D* sprite, Texture2D* mapTex, bool flippedX, bool flippedY, bool tiled, glm::vec4 color)
+{
+	ID = spriteComponentID;
+	this->active = active;
 	this->entity = entity;
 	this->pos = pos;
 
@@ -535,6 +1164,21 @@ ColliderComponent::ColliderComponent(Entity* entity, bool active, PositionCompon
 
 	this->entityClass = entityClass;
 
+	if (platform)
+	{
+		this->layer = platformLayer;
+	}
+	else if (trigger)
+	{
+		this->layer = doesDamage ? damageLayer : triggerLayer;
+	}
+	else
+	{
+		this->layer = (entityClass == EntityClass::player) ? playerLayer : (entityClass == EntityClass::enemy) ? enemyLayer : objectLayer;
+	}
+
+	this->mask = DefaultCollisionMask((CollisionLayer)this->layer);
+
 	this->mass = mass;
 	this->bounce = bounce;
 	this->friction = friction;
@@ -546,13 +1190,15 @@ ColliderComponent::ColliderComponent(Entity* entity, bool active, PositionCompon
 	this->offsetX = offsetX;
 	this->offsetY = offsetY;
 	this->baseOffsetY = offsetY;
+
+	this->proxy = -1;
 }
 
 #pragma endregion
 
 #pragma region Input Component
 
-InputComponent::InputComponent(Entity* entity, bool active, Entity* moonlightBlade, bool acceptInput, float maxCoyoteTime, int maxJumps, float targetDelay, Texture2D* baseMap)
+InputComponent::InputComponent(Entity* entity, bool active, EntityHandle moonlightBlade, bool acceptInput, float maxCoyoteTime, int maxJumps, float targetDelay, Texture2D* baseMap)
 {
 	this->ID = inputComponentID;
 	this->active = active;
@@ -716,7 +1362,7 @@ HealthComponent::HealthComponent(Entity* entity, bool active, float health, bool
 
 #pragma region Damage Component
 
-DamageComponent::DamageComponent(Entity* entity, bool active, Entity* creator, bool hasLifetime, float lifetime, bool showAfterUses, bool limitedUses, int uses, float damage, bool damagesPlayers, bool damagesEnemies, bool damagesObjects, bool lodges)
+DamageComponent::DamageComponent(Entity* entity, bool active, EntityHandle creator, bool hasLifetime, float lifetime, bool showAfterUses, bool limitedUses, int uses, float damage, bool damagesPlayers, bool damagesEnemies, bool damagesObjects, bool lodges)
 {
 	this->ID = damageComponentID;
 	this->entity = entity;
@@ -737,6 +1383,22 @@ DamageComponent::DamageComponent(Entity* entity, bool active, Entity* creator, b
 
 	this->lodges = lodges;
 	this->lodged = false;
+
+	// Whatever this doesn't damage, its collider (which always comes first) doesn't need to run into at all.
+	// If it's used up when it hits, it's a projectile, and projectiles don't run into each other either.
+	ColliderComponent* col = entity->Get<ColliderComponent>();
+
+	if (col != nullptr)
+	{
+		if (col->layer == damageLayer && limitedUses)
+		{
+			col->layer = projectileLayer;
+			col->mask = DefaultCollisionMask(projectileLayer);
+		}
+
+		col->mask &= ~((damagesPlayers ? 0u : (uint32_t)playerLayer) | (damagesEnemies ? 0u : (uint32_t)enemyLayer) | (damagesObjects ? 0u : (uint32_t)objectLayer));
+		col->MarkChanged();
+	}
 }
 
 #pragma endregion
@@ -790,7 +1452,7 @@ AIComponent::AIComponent(Entity* entity, bool active, bool proc, float procRange
 
 #pragma region Blade Component
 
-BladeComponent::BladeComponent(Entity* entity, bool active, float rushRange, float slowRange, float followSpeed, float projectileSpeed, ColliderComponent* platformCollider, Texture2D* corporealMap, Texture2D* incorporealMap, float minTargetSetDelay)
+BladeComponent::BladeComponent(Entity* entity, bool active, float rushRange, float slowRange, float followSpeed, float projectileSpeed, EntityHandle hilt, Texture2D* corporealMap, Texture2D* incorporealMap, float minTargetSetDelay)
 {
 	this->ID = bladeComponentID;
 	this->entity = entity;
@@ -805,7 +1467,7 @@ BladeComponent::BladeComponent(Entity* entity, bool active, float rushRange, flo
 	this->followSpeed = followSpeed;
 	this->projectileSpeed = projectileSpeed;
 
-	this->platformCollider = platformCollider;
+	this->hilt = hilt;
 
 	this->corporealMap = corporealMap;
 	this->incorporealMap = incorporealMap;
@@ -908,17 +1570,31 @@ TextComponent::TextComponent(Entity* entity, bool active, string text, glm::vec4
 
 void StaticRenderingSystem::Update(int activeScene, float deltaTime)
 {
-	std::sort(sprites.begin(), sprites.end(), [](StaticSpriteComponent* a, StaticSpriteComponent* b)
+	// We only sort (and draw) what's in the global and active scenes.
+	auto backToFront = [](StaticSpriteComponent* a, StaticSpriteComponent* b)
 		{
 			return a->pos->z < b->pos->z;
-		});
+		};
 
-	for (int i = 0; i < sprites.size(); i++)
+	if (sprites.version != drawListVersion || activeScene != drawListScene)
 	{
-		StaticSpriteComponent* s = sprites[i];
+		Gather(sprites.Active(activeScene), drawList);
+		std::sort(drawList.begin(), drawList.end(), backToFront);
 
-		if (s->active && s->entity->Get_Scene() == activeScene ||
-			s->active && s->entity->Get_Scene() == 0)
+		drawListVersion = sprites.version;
+		drawListScene = activeScene;
+	}
+	else if (!std::is_sorted(drawList.begin(), drawList.end(), backToFront))
+	{
+		// Hardly anything changes depth, so most frames the list is still in order from last time.
+		std::sort(drawList.begin(), drawList.end(), backToFront);
+	}
+
+	for (int i = 0; i < drawList.size(); i++)
+	{
+		StaticSpriteComponent* s = drawList[i];
+
+		if (s->active)
 		{
 			PositionComponent* pos = s->pos;
 
@@ -934,20 +1610,14 @@ void StaticRenderingSystem::Update(int activeScene, float deltaTime)
 
 void StaticRenderingSystem::AddComponent(Component* component)
 {
-	sprites.push_back((StaticSpriteComponent*)component);
+	sprites.Add((StaticSpriteComponent*)component);
 }
 
 void StaticRenderingSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < sprites.size(); i++)
-	{
-		if (sprites[i]->entity == e)
-		{
-			StaticSpriteComponent* s = sprites[i];
-			sprites.erase(std::remove(sprites.begin(), sprites.end(), s), sprites.end());
-			delete s;
-		}
-	}
+	StaticSpriteComponent* s = e->Get<StaticSpriteComponent>();
+	sprites.Remove(s);
+	ECS::Pool<StaticSpriteComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -956,270 +1626,461 @@ void StaticRenderingSystem::PurgeEntity(Entity* e)
 
 void PhysicsSystem::Update(int activeScene, float deltaTime)
 {
-	for (int i = 0; i < phys.size(); i++)
-	{
-		PhysicsComponent* p = phys[i];
+	PartitionRange<PhysicsComponent*> active = phys.Active(activeScene);
 
-		if (p->active && p->entity->Get_Scene() == activeScene ||
-			p->active && p->entity->Get_Scene() == 0)
+	// Every body's velocity only depends on itself, so we can hand out chunks of them to different threads.
+	ECS::main.scheduler.ParallelFor(active.size(), chunkSize, [&](int begin, int end)
 		{
-			PositionComponent* pos = p->pos;
-			ColliderComponent* col = (ColliderComponent*)p->entity->componentIDMap[colliderComponentID];
-
-			if (!pos->stat)
+			for (int i = begin; i < end; i++)
 			{
-				if (col != nullptr)
+				PhysicsComponent* p = active[i];
+
+				if (p->active)
 				{
-					if (col->entity->componentIDMap[movementComponentID] != nullptr)
-					{
-						MovementComponent* move = (MovementComponent*)col->entity->componentIDMap[movementComponentID];
+					PositionComponent* pos = p->pos;
+					ColliderComponent* col = p->entity->Get<ColliderComponent>();
 
-						if (!move->climbing && !col->onPlatform)
-						{
-							p->velocityY -= p->gravityMod * deltaTime;
-						}
-						else if (move->climbing)
+					if (!pos->stat)
+					{
+						if (col != nullptr)
 						{
-							if (p->velocityY > 0)
+							if (col->entity->Has<MovementComponent>())
 							{
-								p->velocityY -= (p->drag / 4.0f) * deltaTime;
+								MovementComponent* move = col->entity->Get<MovementComponent>();
 
-								if (p->velocityY < 0)
+								if (!move->climbing && !col->onPlatform)
+								{
+									p->velocityY -= p->gravityMod * deltaTime;
+								}
+								else if (move->climbing)
 								{
-									p->velocityY = 0;
+									if (p->velocityY > 0)
+									{
+										p->velocityY -= (p->drag / 4.0f) * deltaTime;
+
+										if (p->velocityY < 0)
+										{
+											p->velocityY = 0;
+										}
+									}
+									else if (p->velocityY < 0)
+									{
+										p->velocityY += (p->drag / 4.0f) * deltaTime;
+
+										if (p->velocityY > 0)
+										{
+											p->velocityY = 0;
+										}
+									}
 								}
 							}
-							else if (p->velocityY < 0)
+							else if (!col->onPlatform)
 							{
-								p->velocityY += (p->drag / 4.0f) * deltaTime;
+								p->velocityY -= p->gravityMod * deltaTime;
+							}
+
+							if (p->velocityX > 0 && col->onPlatform)
+							{
+								p->velocityX -= p->drag * deltaTime;
 
-								if (p->velocityY > 0)
+								if (p->velocityX < 0)
 								{
-									p->velocityY = 0;
+									p->velocityX = 0;
 								}
 							}
-						}
-					}
-					else if (!col->onPlatform)
-					{
-						p->velocityY -= p->gravityMod * deltaTime;
-					}
+							else if (p->velocityX < 0 && col->onPlatform)
+							{
+								p->velocityX += p->drag * deltaTime;\
 
-					if (p->velocityX > 0 && col->onPlatform)
-					{
-						p->velocityX -= p->drag * deltaTime;
+								if (p->velocityX > 0)
+								{
+									p->velocityX = 0;
+								}
+							}
 
-						if (p->velocityX < 0)
+							if (p->velocityY > 0 && col->onPlatform)
+							{
+								p->velocityY -= p->drag * deltaTime;
+							}
+							else if (p->velocityY < 0 && col->onPlatform)
+							{
+								p->velocityY += p->drag * deltaTime;
+							}
+
+							if (p->rotVelocity > 0 && col->onPlatform)
+							{
+								p->rotVelocity -= p->drag * deltaTime;
+							}
+							else if (p->rotVelocity < 0 && col->onPlatform)
+							{
+								p->rotVelocity += p->drag * deltaTime;
+							}
+						}
+						else
 						{
-							p->velocityX = 0;
+							if (p->velocityY > 0)
+							{
+								p->velocityY -= p->drag * deltaTime;
+							}
+							else if (p->velocityY < 0)
+							{
+								p->velocityY += p->drag * deltaTime;
+							}
+
+							if (p->rotVelocity > 0)
+							{
+								p->rotVelocity -= p->drag * deltaTime;
+							}
+							else if (p->rotVelocity < 0)
+							{
+								p->rotVelocity += p->drag * deltaTime;
+							}
+
+							p->velocityY -= p->gravityMod * deltaTime;
 						}
-					}
-					else if (p->velocityX < 0 && col->onPlatform)
-					{
-						p->velocityX += p->drag * deltaTime;\
 
-						if (p->velocityX > 0)
+						if (abs(p->velocityX) < 0.5f)
 						{
 							p->velocityX = 0;
 						}
-					}
 
-					if (p->velocityY > 0 && col->onPlatform)
-					{
-						p->velocityY -= p->drag * deltaTime;
-					}
-					else if (p->velocityY < 0 && col->onPlatform)
-					{
-						p->velocityY += p->drag * deltaTime;
-					}
+						if (abs(p->velocityY) < 0.5f)
+						{
+							p->velocityY = 0;
+						}
 
-					if (p->rotVelocity > 0 && col->onPlatform)
-					{
-						p->rotVelocity -= p->drag * deltaTime;
+						if (abs(p->rotVelocity) < 0.5f)
+						{
+							p->rotVelocity = 0;
+						}
 					}
-					else if (p->rotVelocity < 0 && col->onPlatform)
+					else
 					{
-						p->rotVelocity += p->drag * deltaTime;
+						p->velocityX = 0;
+						p->velocityY = 0;
+						p->rotVelocity = 0;
 					}
 				}
-				else
-				{
-					if (p->velocityY > 0)
-					{
-						p->velocityY -= p->drag * deltaTime;
-					}
-					else if (p->velocityY < 0)
-					{
-						p->velocityY += p->drag * deltaTime;
-					}
+			}
+		});
+}
 
-					if (p->rotVelocity > 0)
-					{
-						p->rotVelocity -= p->drag * deltaTime;
-					}
-					else if (p->rotVelocity < 0)
-					{
-						p->rotVelocity += p->drag * deltaTime;
-					}
+void PhysicsSystem::AddComponent(Component* component)
+{
+	phys.Add((PhysicsComponent*)component);
+}
 
-					p->velocityY -= p->gravityMod * deltaTime;
-				}
+void PhysicsSystem::PurgeEntity(Entity* e)
+{
+	PhysicsComponent* s = e->Get<PhysicsComponent>();
+	phys.Remove(s);
+	ECS::Pool<PhysicsComponent>().Destroy(s);
+}
 
-				if (abs(p->velocityX) < 0.5f)
-				{
-					p->velocityX = 0;
-				}
+#pragma endregion
 
-				if (abs(p->velocityY) < 0.5f)
-				{
-					p->velocityY = 0;
-				}
+#pragma region Position System
 
-				if (abs(p->rotVelocity) < 0.5f)
+void PositionSystem::Update(int activeScene, float deltaTime)
+{
+	// Rather than going through each position (and looking up its physics component),
+	// we just walk the body stream, where every position's coordinates sit right next to its velocity.
+	// Anything that isn't moving (no physics, inactive, wrong scene, or a free slot) gets a step of zero,
+	// which keeps the inner loop free of branches.
+	// The stream's chunks don't share anything, so different threads can take different runs of them.
+	BodyStream& stream = BodyStream::main;
+
+	ECS::main.scheduler.ParallelFor(stream.chunks.size(), chunksPerTask, [&](int begin, int end)
+		{
+			for (int c = begin; c < end; c++)
+			{
+				BodyStream::Chunk& chunk = *stream.chunks[c];
+				int n = min(BodyStream::ChunkSize, stream.end - c * BodyStream::ChunkSize);
+
+				for (int i = 0; i < n; i++)
 				{
-					p->rotVelocity = 0;
+					float step = (chunk.moving[i] && (chunk.scene[i] == activeScene || chunk.scene[i] == 0)) ? deltaTime : 0.0f;
+
+					chunk.x[i] += chunk.velocityX[i] * step;
+					chunk.y[i] += chunk.velocityY[i] * step;
+					chunk.rotation[i] += chunk.rotVelocity[i] * step;
 				}
 			}
-			else
-			{
-				p->velocityX = 0;
-				p->velocityY = 0;
-				p->rotVelocity = 0;
-			}
-		}
+		});
+}
+
+void PositionSystem::AddComponent(Component* component)
+{
+	pos.Add((PositionComponent*)component);
+}
+
+void PositionSystem::PurgeEntity(Entity* e)
+{
+	PositionComponent* s = e->Get<PositionComponent>();
+	pos.Remove(s);
+	ECS::Pool<PositionComponent>().Destroy(s);
+}
+
+#pragma endregion
+
+#pragma region Collider System
+
+AABB ColliderSystem::SweptBox(ColliderComponent* col, PhysicsComponent* phys, float deltaTime)
+{
+	// The box covering the collider where it is now and where it will be at the end of the frame.
+	float cX = col->pos->x + col->offsetX;
+	float cY = col->pos->y + col->offsetY;
+	float halfWidth = col->width / 2.0f;
+	float halfHeight = col->height / 2.0f;
+
+	float dX = 0.0f;
+	float dY = 0.0f;
+
+	if (phys != nullptr)
+	{
+		dX = phys->velocityX * deltaTime;
+		dY = phys->velocityY * deltaTime;
 	}
+
+	return { cX - halfWidth + min(dX, 0.0f), cY - halfHeight + min(dY, 0.0f), cX + halfWidth + max(dX, 0.0f), cY + halfHeight + max(dY, 0.0f) };
 }
 
-void PhysicsSystem::AddComponent(Component* component)
+Broadphase& ColliderSystem::SceneBroadphase(int scene)
 {
-	phys.push_back((PhysicsComponent*)component);
+	while (scene >= broadphases.size())
+	{
+		broadphases.push_back(CreateBroadphase(BroadphaseType::grid));
+	}
+
+	return *broadphases[scene];
 }
 
-void PhysicsSystem::PurgeEntity(Entity* e)
+void ColliderSystem::SetBroadphase(int scene, BroadphaseType type)
 {
-	for (int i = 0; i < phys.size(); i++)
+	SceneBroadphase(scene);
+
+	delete broadphases[scene];
+	broadphases[scene] = CreateBroadphase(type);
+
+	// The old proxies went with the old broadphase, so everything in the scene needs a new one.
+	ComponentView<ColliderComponent, PhysicsComponent>& view = ECS::main.View<ColliderComponent, PhysicsComponent>();
+
+	if (scene < view.rows.size())
 	{
-		if (phys[i]->entity == e)
+		for (int i = 0; i < view.rows[scene].size(); i++)
 		{
-			PhysicsComponent* s = phys[i];
-			phys.erase(std::remove(phys.begin(), phys.end(), s), phys.end());
-			delete s;
+			std::get<0>(view.rows[scene][i])->proxy = -1;
 		}
 	}
 }
 
-#pragma endregion
+void ColliderSystem::QueryRegion(int activeScene, const AABB& box, vector<ColliderComponent*>& out, uint32_t layers)
+{
+	candidates.clear();
+	SceneBroadphase(0).Query(box, candidates);
 
-#pragma region Position System
+	if (activeScene != 0)
+	{
+		SceneBroadphase(activeScene).Query(box, candidates);
+	}
 
-void PositionSystem::Update(int activeScene, float deltaTime)
-{
-	for (int i = 0; i < pos.size(); i++)
+	// The broadphase only knows the swept boxes, so we check where each collider really is.
+	for (int i = 0; i < candidates.size(); i++)
 	{
-		PositionComponent* p = pos[i];
-		PhysicsComponent* phys = (PhysicsComponent*)p->entity->componentIDMap[physicsComponentID];
+		ColliderComponent* c = candidates[i];
 
-		if (p->active && phys != nullptr && p->entity->Get_Scene() == activeScene ||
-			p->active && phys != nullptr && p->entity->Get_Scene() == 0)
+		if (c->active && (c->layer & layers) != 0 && Overlaps(SweptBox(c, nullptr, 0.0f), box))
 		{
-			p->x += phys->velocityX * deltaTime;
-			p->y += phys->velocityY * deltaTime;
-			p->rotation += phys->rotVelocity * deltaTime;
+			out.push_back(c);
 		}
 	}
 }
 
-void PositionSystem::AddComponent(Component* component)
+void ColliderSystem::Raycast(int activeScene, float fromX, float fromY, float toX, float toY, vector<RayHit>& out, uint32_t layers)
 {
-	pos.push_back((PositionComponent*)component);
-}
+	int first = out.size();
 
-void PositionSystem::PurgeEntity(Entity* e)
-{
-	for (int i = 0; i < pos.size(); i++)
+	vector<RayHit> hits;
+	SceneBroadphase(0).Raycast(fromX, fromY, toX, toY, hits);
+
+	if (activeScene != 0)
+	{
+		SceneBroadphase(activeScene).Raycast(fromX, fromY, toX, toY, hits);
+	}
+
+	for (int i = 0; i < hits.size(); i++)
 	{
-		if (pos[i]->entity == e)
+		ColliderComponent* c = hits[i].collider;
+		float fraction;
+
+		if (c->active && (c->layer & layers) != 0 && RayOverlaps(SweptBox(c, nullptr, 0.0f), fromX, fromY, toX - fromX, toY - fromY, fraction))
 		{
-			PositionComponent* s = pos[i];
-			pos.erase(std::remove(pos.begin(), pos.end(), s), pos.end());
-			delete s;
+			out.push_back({ c, fraction });
 		}
 	}
+
+	std::sort(out.begin() + first, out.end(), [](const RayHit& a, const RayHit& b)
+		{
+			return a.fraction < b.fraction;
+		});
 }
 
-#pragma endregion
+void ColliderSystem::UpdateBroadphase(int activeScene, float deltaTime)
+{
+	PartitionRange<tuple<ColliderComponent*, PhysicsComponent*>> bodies = ECS::main.View<ColliderComponent, PhysicsComponent>().Active(activeScene);
 
-#pragma region Collider System
+	for (int i = 0; i < bodies.size(); i++)
+	{
+		auto [c, phys] = bodies[i];
+
+		if (!c->active)
+		{
+			// Inactive colliders keep whatever cells they had; they're skipped when we query anyway.
+			continue;
+		}
+
+		if (c->proxy != -1 && !c->pos->Moved(lastRun) && !c->ChangedSince(lastRun))
+		{
+			// Static colliders nobody's touched since last frame are already where they should be.
+			continue;
+		}
+
+		AABB box = SweptBox(c, phys, deltaTime);
+		Broadphase& broadphase = SceneBroadphase(c->partition);
+
+		if (c->proxy == -1)
+		{
+			c->proxy = broadphase.CreateProxy(c, box, c->pos->stat, c->layer, c->mask);
+			continue;
+		}
+
+		if (c->ChangedSince(lastRun))
+		{
+			// Its layer or mask might be what changed.
+			broadphase.SetFilter(c->proxy, c->layer, c->mask);
+		}
+
+		if (broadphase.IsStatic(c->proxy))
+		{
+			// Static colliders only get re-bucketed if someone actually moved or resized them.
+			const AABB& old = broadphase.GetBox(c->proxy);
+
+			if (old.minX != box.minX || old.minY != box.minY || old.maxX != box.maxX || old.maxY != box.maxY)
+			{
+				broadphase.MoveProxy(c->proxy, box);
+			}
+		}
+		else
+		{
+			broadphase.MoveProxy(c->proxy, box);
+		}
+	}
+}
 
 void ColliderSystem::Update(int activeScene, float deltaTime)
 {
-	for (int i = 0; i < colls.size(); i++)
+	UpdateBroadphase(activeScene, deltaTime);
+
+	contacts.clear();
+
+	// Every collider needs a physics component for the narrowphase to work with, so we only look at the ones that have both.
+	PartitionRange<tuple<ColliderComponent*, PhysicsComponent*>> bodies = ECS::main.View<ColliderComponent, PhysicsComponent>().Active(activeScene);
+
+	for (int i = 0; i < bodies.size(); i++)
 	{
-		ColliderComponent* cA = colls[i];
+		auto [cA, physA] = bodies[i];
 
-		if (cA->active && cA->entity->Get_Scene() == activeScene ||
-			cA->active && cA->entity->Get_Scene() == 0)
+		if (cA->active)
 		{
 			cA->onPlatform = false;
 			cA->collidedLastTick = false;
 
 			PositionComponent* posA = cA->pos;
-			PhysicsComponent* physA = (PhysicsComponent*)cA->entity->componentIDMap[physicsComponentID];
 
 			/*Texture2D* t = Game::main.textureMap["blank"];
 			Texture2D* tMap = Game::main.textureMap["base_map"];
 			Game::main.renderer->prepareQuad(glm::vec2(posA->x + cA->offsetX, posA->y + cA->offsetY), cA->width, cA->height, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), t->ID, tMap->ID);*/
 			
-			std::vector<std::pair<Collision*, float>> z;
+			// This collider's contacts live at the end of the frame's buffer.
+			int first = contacts.size();
 
-			for (int j = 0; j < colls.size(); j++)
+			// Platforms never move into anything themselves, so they don't need to ask the broadphase
+			// for anything; everything else only looks at the colliders whose boxes overlap its own.
+			// Triggers are left to the overlap pass below, from both sides.
+			candidates.clear();
+
+			if (!cA->platform && !cA->trigger)
 			{
-				ColliderComponent* cB = colls[j];
+				FindCandidates(cA, activeScene);
+			}
+
+			// All of this collider's candidates go through the narrowphase together (see narrowphase.h);
+			// this is the same test DynamicArbitraryRectangleCollision() does, just several pairs at a time.
+			sweeps.Clear();
+			swept.clear();
+
+			glm::vec2 originA = glm::vec2(posA->x + cA->offsetX, posA->y + cA->offsetY);
 
-				if (cB->active && cB->entity->Get_ID() != cA->entity->Get_ID())
+			for (int j = 0; j < candidates.size(); j++)
+			{
+				ColliderComponent* cB = candidates[j];
+
+				if (cB->active && !cB->trigger && cB->entity->Get_ID() != cA->entity->Get_ID())
 				{
-					PositionComponent* posB = (PositionComponent*)cB->entity->componentIDMap[positionComponentID];
-					PhysicsComponent* physB = (PhysicsComponent*)cB->entity->componentIDMap[physicsComponentID];
+					PositionComponent* posB = cB->pos;
+					PhysicsComponent* physB = cB->entity->Get<PhysicsComponent>();
 
-					float combVel = glm::length2(glm::vec2(physA->velocityX + physB->velocityX, physA->velocityY + physB->velocityY));
-					float combSize = glm::length2(glm::vec2((cA->width + cB->width) / 2.0f, (cA->height + cB->height) / 2.0f));
-					float dist = glm::length2(glm::vec2(posA->x + cA->offsetX, posA->y + cA->offsetY) - glm::vec2(posB->x + cB->offsetX, posB->y + cB->offsetY));
+					glm::vec2 relVel = glm::vec2(physA->velocityX, physA->velocityY) - glm::vec2(physB->velocityX, physB->velocityY);
 
-					if (!cA->platform && dist <= combVel + combSize)
-					{
-						glm::vec2 contactPoint, contactNormal;
-						float time;
+					sweeps.Add(originA, relVel * deltaTime, glm::vec2(posB->x + cB->offsetX, posB->y + cB->offsetY), cB->width + cA->width, cB->height + cA->height);
+					swept.push_back({ cB, relVel });
+				}
+			}
 
-						Collision* c = DynamicArbitraryRectangleCollision(cA, posA, physA, cB, posB, physB, deltaTime);
+			SweptAABB(sweeps);
 
-						if (c != nullptr)
-						{
-							cA->collidedLastTick = true;
-							cB->collidedLastTick = true;
+			for (int j = 0; j < swept.size(); j++)
+			{
+				if (sweeps.hit[j])
+				{
+					ColliderComponent* cB = swept[j].first;
 
-							z.push_back(std::pair(c, c->time));
-						}
-					}
+					Collision c = Collision(glm::vec2(sweeps.contactX[j], sweeps.contactY[j]), glm::vec2(sweeps.normalX[j], sweeps.normalY[j]), sweeps.time[j], cB, (!cA->trigger && !cB->trigger));
+					c.relVel = swept[j].second;
+
+					cA->collidedLastTick = true;
+					cB->collidedLastTick = true;
+
+					contacts.push_back(c);
 				}
 			}
 
 			// Sort the collisions for distance.
-			std::sort(z.begin(), z.end(), [](const std::pair<Collision*, float>& a, const std::pair<Collision*, float>& b)
+			std::sort(contacts.begin() + first, contacts.end(), [](const Collision& a, const Collision& b)
 				{
-					return a.second < b.second;
+					return a.time < b.time;
 				});
 
 			// Resolve all the collisions we just made.
-			for (auto j : z)
+			for (int j = first; j < contacts.size(); j++)
 			{
-				ColliderComponent* cB = j.first->colB;
-				PositionComponent* posB = (PositionComponent*)cB->entity->componentIDMap[positionComponentID];
-				PhysicsComponent* physB = (PhysicsComponent*)cB->entity->componentIDMap[physicsComponentID];
+				Collision* c = &contacts[j];
 
-				Collision* c = nullptr;
-				c = DynamicArbitraryRectangleCollision(cA, posA, physA, cB, posB, physB, deltaTime);
+				ColliderComponent* cB = c->colB;
+				PositionComponent* posB = cB->pos;
+				PhysicsComponent* physB = cB->entity->Get<PhysicsComponent>();
 
-				if (c != nullptr)
+				// Nothing in here moves anything, so the contact we found above is still good unless resolving
+				// an earlier one changed either collider's velocity; in that case, we refresh it in place.
+				glm::vec2 relVel = glm::vec2(physA->velocityX - physB->velocityX, physA->velocityY - physB->velocityY);
+				bool hit = true;
+
+				if (relVel != c->relVel)
+				{
+					hit = DynamicArbitraryRectangleCollision(cA, posA, physA, cB, posB, physB, deltaTime, *c);
+				}
+
+				if (hit)
 				{
 					if (c->resolve && !cB->onewayPlatform ||
 						c->resolve && cB->platform && cB->onewayPlatform && c->contactNormal.y == 1 && !cA->ignoreOnewayPlatforms)
@@ -1231,7 +2092,7 @@ void ColliderSystem::Update(int activeScene, float deltaTime)
 						physA->velocityY = velAdd.y;
 					}
 
-					MovementComponent* moveA = (MovementComponent*)cA->entity->componentIDMap[movementComponentID];
+					MovementComponent* moveA = cA->entity->Get<MovementComponent>();
 					if (cB->platform && c->contactNormal.y == 1)
 					{
 						cA->onPlatform = true;
@@ -1248,128 +2109,214 @@ void ColliderSystem::Update(int activeScene, float deltaTime)
 						}
 					}
 
-					if (cB->climbable && c->contactNormal.x != 0 && moveA != nullptr)
-					{
+					if (cB->climbable && c->contactNormal.x != 0 && moveA != nullptr)
+					{
+
+						if (moveA->canClimb && moveA->shouldClimb)
+						{
+							if (!moveA->climbing)
+							{
+								// If you just started climbing, stop all other velocity.
+								physA->velocityX = 0;
+								physA->velocityY = 0;
+
+								moveA->maxClimbHeight = cA->pos->y;
+								moveA->minClimbHeight = cB->pos->y - (cB->height / 2.0f);
+							}
+
+							moveA->climbing = true;
+						}	// Bin gar keine Russin, stamm� aus Litauen, echt deutsch.
+					}	// And when we were children, staying at the arch-duke's,
+				}	// My cousin's, he took me out on a sled,
+			}	// And I was frightened. He said, Marie,
+			 // Marie, hold on tight. And down we went.
+		} // In the mountains, there you feel free.
+	} // I read, much of the night,
+
+	UpdateTriggers(activeScene, deltaTime);
+} // and go south in the winter.
+
+void ColliderSystem::FindCandidates(ColliderComponent* c, int activeScene)
+{
+	if (c->proxy == -1)
+	{
+		return;
+	}
+
+	// Its own scene's broadphase already knows what its proxy overlaps (which, with sweep and prune, is just a list to read),
+	// and the other scene's is asked about its box.
+	SceneBroadphase(c->partition).Overlapping(c->proxy, candidates);
+
+	if (activeScene != 0)
+	{
+		int first = candidates.size();
+		SceneBroadphase((c->partition == 0) ? activeScene : 0).Query(SceneBroadphase(c->partition).GetBox(c->proxy), candidates);
+
+		// Plain queries don't look at layers, so that's done here.
+		candidates.erase(std::remove_if(candidates.begin() + first, candidates.end(), [c](ColliderComponent* other)
+			{
+				return !Interacts(c->layer, c->mask, other->layer, other->mask);
+			}), candidates.end());
+	}
+}
+
+void ColliderSystem::UpdateTriggers(int activeScene, float deltaTime)
+{
+	// Triggers don't push anything around, so all they need to know is what their swept boxes overlap;
+	// the broadphase already worked that out, so there's no narrowphase at all.
+	PartitionRange<tuple<ColliderComponent*, PhysicsComponent*>> bodies = ECS::main.View<ColliderComponent, PhysicsComponent>().Active(activeScene);
+
+	triggerContacts.clear();
+
+	for (int i = 0; i < bodies.size(); i++)
+	{
+		ColliderComponent* t = std::get<0>(bodies[i]);
+
+		if (!t->active || !t->trigger)
+		{
+			continue;
+		}
+
+		candidates.clear();
+		FindCandidates(t, activeScene);
+
+		for (int j = 0; j < candidates.size(); j++)
+		{
+			ColliderComponent* other = candidates[j];
+
+			if (other->active && other->entity->Get_ID() != t->entity->Get_ID())
+			{
+				t->collidedLastTick = true;
+				other->collidedLastTick = true;
+
+				uint64_t key = ((uint64_t)t->entity->Get_ID() << 32) | other->entity->Get_ID();
+				triggerContacts.push_back({ key, t, other });
+			}
+		}
+	}
 
-						if (moveA->canClimb && moveA->shouldClimb)
-						{
-							if (!moveA->climbing)
-							{
-								// If you just started climbing, stop all other velocity.
-								physA->velocityX = 0;
-								physA->velocityY = 0;
+	// Both this frame's contacts and last frame's are sorted by key, so walking them side by side tells us
+	// which pairs just started overlapping, which still are, and which just stopped.
+	std::sort(triggerContacts.begin(), triggerContacts.end(), [](const TriggerContact& a, const TriggerContact& b)
+		{
+			return a.key < b.key;
+		});
 
-								moveA->maxClimbHeight = cA->pos->y;
-								moveA->minClimbHeight = cB->pos->y - (cB->height / 2.0f);
-							}
+	triggerEvents.clear();
+	entered.clear();
 
-							moveA->climbing = true;
-						}
-					}
+	int now = 0;
+	int last = 0;
 
-					if (cA->trigger && cA->doesDamage)
-					{
-						DamageComponent* aDamage = (DamageComponent*)cA->entity->componentIDMap[damageComponentID];
+	while (now < triggerContacts.size() || last < lastTriggerKeys.size())
+	{
+		uint64_t nowKey = (now < triggerContacts.size()) ? triggerContacts[now].key : UINT64_MAX;
+		uint64_t lastKey = (last < lastTriggerKeys.size()) ? lastTriggerKeys[last] : UINT64_MAX;
 
-						if (aDamage->creator != cB->entity)
-						{
-							if (aDamage->lodges)
-							{
-								ParticleEngine::main.AddParticles(5, physA->pos->x, physA->pos->y, physA->pos->z, Element::dust, rand() % 10 + 1);
-								aDamage->lodged = true;
+		EntityHandle trigger;
+		EntityHandle other;
+		TriggerEventType type;
 
-								cA->active = false;
+		if (nowKey < lastKey)
+		{
+			type = TriggerEventType::enter;
+			entered.push_back({ triggerContacts[now].trigger, triggerContacts[now].other });
+			trigger.value = (uint32_t)(nowKey >> 32);
+			other.value = (uint32_t)nowKey;
+			now++;
+		}
+		else if (nowKey == lastKey)
+		{
+			type = TriggerEventType::stay;
+			trigger.value = (uint32_t)(nowKey >> 32);
+			other.value = (uint32_t)nowKey;
+			now++;
+			last++;
+		}
+		else
+		{
+			type = TriggerEventType::exit;
+			trigger.value = (uint32_t)(lastKey >> 32);
+			other.value = (uint32_t)lastKey;
+			last++;
+		}
 
-								physA->velocityX = 0.0f;
-								physA->velocityY = 0.0f;
-								physA->gravityMod = 0.0f;
-							}
+		triggerEvents.push_back({ trigger, other, type });
+	}
 
-							if (cB->takesDamage)
-							{
-								if (cB->entityClass == EntityClass::player && aDamage->damagesPlayers ||
-									cB->entityClass == EntityClass::enemy && aDamage->damagesEnemies ||
-									cB->entityClass == EntityClass::object && aDamage->damagesObjects)
-								{
-									HealthComponent* bHealth = (HealthComponent*)cB->entity->componentIDMap[healthComponentID];
-									bHealth->health -= aDamage->damage;
-									aDamage->uses -= 1;
-								}
-							}
-							else
-							{
-								aDamage->uses -= 1;
-							}
+	lastTriggerKeys.clear();
 
-							if (aDamage->uses <= 0)
-							{
-								cA->active = false;
+	for (int i = 0; i < triggerContacts.size(); i++)
+	{
+		lastTriggerKeys.push_back(triggerContacts[i].key);
+	}
 
-								if (!aDamage->showAfterUses)
-								{
-									ECS::main.AddDeadEntity(aDamage->entity);
-								}
-							}
+	// Damage only lands when something first enters a damage volume, all at once.
+	for (int i = 0; i < entered.size(); i++)
+	{
+		if (entered[i].a->doesDamage)
+		{
+			ApplyDamage(entered[i].a, entered[i].b, deltaTime);
+		}
+	}
+}
 
-							aDamage->lifetime -= deltaTime;
-						}
-					}
-					if (cB->trigger && cB->doesDamage)
-					{
-						DamageComponent* bDamage = (DamageComponent*)cB->entity->componentIDMap[damageComponentID];
+void ColliderSystem::ApplyDamage(ColliderComponent* source, ColliderComponent* target, float deltaTime)
+{
+	// A damage volume that's already used up (or lodged in something) earlier in the batch doesn't get to hit anything else.
+	if (!source->active)
+	{
+		return;
+	}
 
-						if (bDamage->creator != cA->entity)
-						{
-							if (bDamage->lodges)
-							{
-								bDamage->lodged = true;
+	DamageComponent* damage = source->entity->Get<DamageComponent>();
+	PhysicsComponent* phys = source->entity->Get<PhysicsComponent>();
 
-								ParticleEngine::main.AddParticles(5, physB->pos->x, physB->pos->y, physA->pos->z, Element::dust, rand() % 10 + 1);
-								cB->active = false;
+	if (damage->creator == target->entity->Get_Handle())
+	{
+		return;
+	}
 
-								physB->velocityX = 0.0f;
-								physB->velocityY = 0.0f;
-								physB->gravityMod = 0.0f;
-							}
+	if (damage->lodges)
+	{
+		ParticleEngine::main.AddParticles(5, phys->pos->x, phys->pos->y, phys->pos->z, Element::dust, rand() % 10 + 1);
+		damage->lodged = true;
 
-							if (bDamage->creator != cA->entity)
-							{
-								if (cA->takesDamage)
-								{
-									if (cA->entityClass == EntityClass::player && bDamage->damagesPlayers ||
-										cA->entityClass == EntityClass::enemy && bDamage->damagesEnemies ||
-										cA->entityClass == EntityClass::object && bDamage->damagesObjects)
-									{
-										HealthComponent* aHealth = (HealthComponent*)cA->entity->componentIDMap[healthComponentID];
-										aHealth->health -= bDamage->damage;
-										bDamage->uses -= 1;
-									}
-								}
-								else
-								{
-									bDamage->uses -= 1;
-								}
+		source->active = false;
 
-								if (bDamage->uses <= 0)
-								{
-									cB->active = false;
+		phys->velocityX = 0.0f;
+		phys->velocityY = 0.0f;
+		phys->gravityMod = 0.0f;
+	}
 
-									if (!bDamage->showAfterUses)
-									{
-										ECS::main.AddDeadEntity(bDamage->entity);
-									}
-								}
+	if (target->takesDamage)
+	{
+		if (target->entityClass == EntityClass::player && damage->damagesPlayers ||
+			target->entityClass == EntityClass::enemy && damage->damagesEnemies ||
+			target->entityClass == EntityClass::object && damage->damagesObjects)
+		{
+			HealthComponent* health = target->entity->Get<HealthComponent>();
+			health->health -= damage->damage;
+			damage->uses -= 1;
+		}
+	}
+	else
+	{
+		damage->uses -= 1;
+	}
 
-								bDamage->lifetime -= deltaTime;
-							}
-						}	// Bin gar keine Russin, stamm� aus Litauen, echt deutsch.
-					}	// And when we were children, staying at the arch-duke's,
-				}	// My cousin's, he took me out on a sled,
-			}	// And I was frightened. He said, Marie,
-			 // Marie, hold on tight. And down we went.
-		} // In the mountains, there you feel free.
-	} // I read, much of the night,
-} // and go south in the winter.
+	if (damage->uses <= 0)
+	{
+		source->active = false;
+
+		if (!damage->showAfterUses)
+		{
+			ECS::main.Commands().DestroyEntity(damage->entity);
+		}
+	}
+
+	damage->lifetime -= deltaTime;
+}
 
 bool ColliderSystem::RaycastDown(float size, float distance, ColliderComponent* colA, PositionComponent* posA, ColliderComponent* colB, PositionComponent* posB)
 {
@@ -1772,7 +2719,7 @@ bool ColliderSystem::TestAndResolveCollision(ColliderComponent* colA, PositionCo
 	return collided;
 }
 
-Collision* ColliderSystem::ArbitraryRectangleCollision(ColliderComponent* colA, PositionComponent* posA, PhysicsComponent* physA, ColliderComponent* colB, PositionComponent* posB, PhysicsComponent* physB, float deltaTime)
+bool ColliderSystem::ArbitraryRectangleCollision(ColliderComponent* colA, PositionComponent* posA, PhysicsComponent* physA, ColliderComponent* colB, PositionComponent* posB, PhysicsComponent* physB, float deltaTime, Collision& out)
 {
 	glm::vec2 rayOrigin = glm::vec2(posA->x, posA->y);
 	glm::vec2 rayDir = glm::vec2(physA->velocityX, physA->velocityY);
@@ -1789,14 +2736,16 @@ Collision* ColliderSystem::ArbitraryRectangleCollision(ColliderComponent* colA,
 	{
 		if (time < 1.0f && time >= 0.0f)
 		{
-			return new Collision(contactPoint, contactNormal, time, colB, (!colA->trigger && !colB->trigger));
+			out = Collision(contactPoint, contactNormal, time, colB, (!colA->trigger && !colB->trigger));
+			out.relVel = rayDir;
+			return true;
 		}
 	}
 
-	return nullptr;
+	return false;
 }
 
-Collision* ColliderSystem::DynamicArbitraryRectangleCollision(ColliderComponent* colA, PositionComponent* posA, PhysicsComponent* physA, ColliderComponent* colB, PositionComponent* posB, PhysicsComponent* physB, float deltaTime)
+bool ColliderSystem::DynamicArbitraryRectangleCollision(ColliderComponent* colA, PositionComponent* posA, PhysicsComponent* physA, ColliderComponent* colB, PositionComponent* posB, PhysicsComponent* physB, float deltaTime, Collision& out)
 {
 	glm::vec2 rayOrigin = glm::vec2(posA->x + colA->offsetX, posA->y + colA->offsetY);
 	glm::vec2 rayDir =  glm::vec2(physA->velocityX, physA->velocityY) - glm::vec2(physB->velocityX, physB->velocityY);
@@ -1813,11 +2762,13 @@ Collision* ColliderSystem::DynamicArbitraryRectangleCollision(ColliderComponent*
 	{
 		if (time < 1.0f && time >= 0.0f)
 		{
-			return new Collision(contactPoint, contactNormal, time, colB, (!colA->trigger && !colB->trigger));
+			out = Collision(contactPoint, contactNormal, time, colB, (!colA->trigger && !colB->trigger));
+			out.relVel = rayDir;
+			return true;
 		}
 	}
 
-	return nullptr;
+	return false;
 }
 
 float ColliderSystem::Dot(glm::vec2 a, glm::vec2 b)
@@ -1837,19 +2788,24 @@ glm::vec2 ColliderSystem::Bounce(glm::vec2 v, glm::vec2 n)
 
 void ColliderSystem::AddComponent(Component* component)
 {
-	colls.push_back((ColliderComponent*)component);
+	colls.Add((ColliderComponent*)component);
 }
 
 void ColliderSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < colls.size(); i++)
+	ColliderComponent* s = e->Get<ColliderComponent>();
+
+	DropProxy(s);
+	colls.Remove(s);
+	ECS::Pool<ColliderComponent>().Destroy(s);
+}
+
+void ColliderSystem::DropProxy(ColliderComponent* c)
+{
+	if (c->proxy != -1)
 	{
-		if (colls[i]->entity == e)
-		{
-			ColliderComponent* s = colls[i];
-			colls.erase(std::remove(colls.begin(), colls.end(), s), colls.end());
-			delete s;
-		}
+		SceneBroadphase(c->partition).DestroyProxy(c->proxy);
+		c->proxy = -1;
 	}
 }
 
@@ -1859,25 +2815,35 @@ void ColliderSystem::PurgeEntity(Entity* e)
 
 void InputSystem::Update(int activeScene, float deltaTime)
 {
-	for (int i = 0; i < move.size(); i++)
+	PartitionRange<tuple<InputComponent*, MovementComponent*, PhysicsComponent*, ColliderComponent*, HealthComponent*>> view = ECS::main.View<InputComponent, MovementComponent, PhysicsComponent, ColliderComponent, HealthComponent>().Active(activeScene);
+
+	for (int i = 0; i < view.size(); i++)
 	{
-		InputComponent* m = move[i];
+		auto [m, move, phys, col, health] = view[i];
 
-		if (m->active && m->entity->Get_Scene() == activeScene ||
-			m->active && m->entity->Get_Scene() == 0)
+		if (m->active)
 		{
+			// Input is all about moving yourself and your blade around;
+			// if the blade has stopped existing somehow, there's nothing for us to do.
+			Entity* moonlightBlade = ECS::main.GetEntity(m->moonlightBlade);
+
+			if (moonlightBlade == nullptr)
+			{
+				continue;
+			}
+
 			bool usingGamepad = false;
 
-			bool shoot = ((glfwGetKey(Game::main.window, Game::main.bladeShootKey) == GLFW_PRESS) || (glfwGetMouseButton(Game::main.window, Game::main.bladeShootKey) == GLFW_PRESS));
-			bool bladeManualTarget = ((glfwGetKey(Game::main.window, Game::main.bladeManualTargetKey) == GLFW_PRESS) || (glfwGetMouseButton(Game::main.window, Game::main.bladeManualTargetKey) == GLFW_PRESS));
-			bool bladeThrow = ((glfwGetKey(Game::main.window, Game::main.bladeThrowKey) == GLFW_PRESS) || (glfwGetMouseButton(Game::main.window, Game::main.bladeThrowKey) == GLFW_PRESS));
-			bool climb = ((glfwGetKey(Game::main.window, Game::main.climbKey) == GLFW_PRESS) || (glfwGetMouseButton(Game::main.window, Game::main.climbKey) == GLFW_PRESS));
-			bool jump = ((glfwGetKey(Game::main.window, Game::main.jumpKey) == GLFW_PRESS) || (glfwGetMouseButton(Game::main.window, Game::main.jumpKey) == GLFW_PRESS));
-			bool crouch = ((glfwGetKey(Game::main.window, Game::main.crouchKey) == GLFW_PRESS) || (glfwGetMouseButton(Game::main.window, Game::main.crouchKey) == GLFW_PRESS));
-			bool climbUp = ((glfwGetKey(Game::main.window, Game::main.climbUpKey) == GLFW_PRESS) || (glfwGetMouseButton(Game::main.window, Game::main.climbUpKey) == GLFW_PRESS));
-			bool climbDown = ((glfwGetKey(Game::main.window, Game::main.climbDownKey) == GLFW_PRESS) || (glfwGetMouseButton(Game::main.window, Game::main.climbDownKey) == GLFW_PRESS));
-			bool moveRight = ((glfwGetKey(Game::main.window, Game::main.moveRightKey) == GLFW_PRESS) || (glfwGetMouseButton(Game::main.window, Game::main.moveRightKey) == GLFW_PRESS));
-			bool moveLeft = ((glfwGetKey(Game::main.window, Game::main.moveLeftKey) == GLFW_PRESS) || (glfwGetMouseButton(Game::main.window, Game::main.moveLeftKey) == GLFW_PRESS));
+			bool shoot = Game::main.input->Held(Game::main.bladeShootKey);
+			bool bladeManualTarget = Game::main.input->Held(Game::main.bladeManualTargetKey);
+			bool bladeThrow = Game::main.input->Held(Game::main.bladeThrowKey);
+			bool climb = Game::main.input->Held(Game::main.climbKey);
+			bool jump = Game::main.input->Held(Game::main.jumpKey);
+			bool crouch = Game::main.input->Held(Game::main.crouchKey);
+			bool climbUp = Game::main.input->Held(Game::main.climbUpKey);
+			bool climbDown = Game::main.input->Held(Game::main.climbDownKey);
+			bool moveRight = Game::main.input->Held(Game::main.moveRightKey);
+			bool moveLeft = Game::main.input->Held(Game::main.moveLeftKey);
 
 			bool swordRotRight = false;
 			bool swordRotLeft = false;
@@ -1885,13 +2851,12 @@ void InputSystem::Update(int activeScene, float deltaTime)
 			bool swordRotDown = false;
 			glm::vec2 swordNormal = glm::vec2(0, 0);
 
-			if (glfwJoystickIsGamepad(GLFW_JOYSTICK_1))
+			GLFWgamepadstate state;
+
+			if (Game::main.input->Gamepad(state))
 			{
 				usingGamepad = true;
 
-				GLFWgamepadstate state;
-				glfwGetGamepadState(GLFW_JOYSTICK_1, &state);
-
 				// std::cout << std::to_string(state.axes[Game::main.moveRightPad]) + "\n";
 
 				// This needs fixing.
@@ -1983,16 +2948,12 @@ void InputSystem::Update(int activeScene, float deltaTime)
 				}
 			}
 
-			BladeComponent* blade = (BladeComponent*)m->moonlightBlade->componentIDMap[bladeComponentID];
-			MovementComponent* move = (MovementComponent*)m->entity->componentIDMap[movementComponentID];
+			BladeComponent* blade = moonlightBlade->Get<BladeComponent>();
 
 			Element magicParticles = Element::aether;
 			Element mundaneParticles = Element::dust;
 
-			PhysicsComponent* phys = (PhysicsComponent*)m->entity->componentIDMap[physicsComponentID];
-			ColliderComponent* col = (ColliderComponent*)m->entity->componentIDMap[colliderComponentID];
-			HealthComponent* health = (HealthComponent*)m->entity->componentIDMap[healthComponentID];
-			AnimationControllerComponent* animator = (AnimationControllerComponent*)m->entity->componentIDMap[animationComponentID];
+			AnimationControllerComponent* animator = m->entity->Get<AnimationControllerComponent>();
 
 			glm::vec3 playerPos = glm::vec3(phys->pos->x, phys->pos->y, phys->pos->z);
 
@@ -2039,9 +3000,9 @@ void InputSystem::Update(int activeScene, float deltaTime)
 				}
 
 				// Blade Handling
-				PositionComponent* bladePosComp = (PositionComponent*)m->moonlightBlade->componentIDMap[positionComponentID];
-				PhysicsComponent* bladePhys = (PhysicsComponent*)blade->entity->componentIDMap[physicsComponentID];
-				DamageComponent* bladeDamage = (DamageComponent*)blade->entity->componentIDMap[damageComponentID];
+				PositionComponent* bladePosComp = moonlightBlade->Get<PositionComponent>();
+				PhysicsComponent* bladePhys = blade->entity->Get<PhysicsComponent>();
+				DamageComponent* bladeDamage = blade->entity->Get<DamageComponent>();
 				glm::vec2 bladePos = glm::vec2(bladePosComp->x, bladePosComp->y);
 
 				blade->lastTargetSet += deltaTime;
@@ -2141,7 +3102,7 @@ void InputSystem::Update(int activeScene, float deltaTime)
 					|| jump && move->canMove && m->releasedJump && !col->onPlatform && m->maxJumps > 1 && m->jumps < m->maxJumps
 					|| jump && move->canMove && m->releasedJump && move->wallRunning)
 				{
-					AnimationComponent* anComp = (AnimationComponent*)m->entity->componentIDMap[animationComponentID];
+					AnimationComponent* anComp = m->entity->Get<AnimationComponent>();
 					if (!col->onPlatform && m->jumps == 0 && m->coyoteTime > m->maxCoyoteTime)
 					{
 						m->jumps += 2;
@@ -2277,20 +3238,14 @@ void InputSystem::Update(int activeScene, float deltaTime)
 
 void InputSystem::AddComponent(Component* component)
 {
-	move.push_back((InputComponent*)component);
+	move.Add((InputComponent*)component);
 }
 
 void InputSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < move.size(); i++)
-	{
-		if (move[i]->entity == e)
-		{
-			InputComponent* s = move[i];
-			move.erase(std::remove(move.begin(), move.end(), s), move.end());
-			delete s;
-		}
-	}
+	InputComponent* s = e->Get<InputComponent>();
+	move.Remove(s);
+	ECS::Pool<InputComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -2299,14 +3254,14 @@ void InputSystem::PurgeEntity(Entity* e)
 
 void CameraFollowSystem::Update(int activeScene, float deltaTime)
 {
-	for (int i = 0; i < folls.size(); i++)
+	PartitionRange<tuple<CameraFollowComponent*, PositionComponent*>> view = ECS::main.View<CameraFollowComponent, PositionComponent>().Active(activeScene);
+
+	for (int i = 0; i < view.size(); i++)
 	{
-		CameraFollowComponent* f = folls[i];
+		auto [f, pos] = view[i];
 
-		if (f->active && f->entity->Get_Scene() == activeScene ||
-			f->active && f->entity->Get_Scene() == 0)
+		if (f->active)
 		{
-			PositionComponent* pos = (PositionComponent*)f->entity->componentIDMap[positionComponentID];
 
 			if (!f->lockX)
 			{
@@ -2327,20 +3282,14 @@ float CameraFollowSystem::Lerp(float a, float b, float t)
 
 void CameraFollowSystem::AddComponent(Component* component)
 {
-	folls.push_back((CameraFollowComponent*)component);
+	folls.Add((CameraFollowComponent*)component);
 }
 
 void CameraFollowSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < folls.size(); i++)
-	{
-		if (folls[i]->entity == e)
-		{
-			CameraFollowComponent* s = folls[i];
-			folls.erase(std::remove(folls.begin(), folls.end(), s), folls.end());
-			delete s;
-		}
-	}
+	CameraFollowComponent* s = e->Get<CameraFollowComponent>();
+	folls.Remove(s);
+	ECS::Pool<CameraFollowComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -2349,12 +3298,13 @@ void CameraFollowSystem::PurgeEntity(Entity* e)
 
 void AnimationControllerSystem::Update(int activeScene, float deltaTime)
 {
-	for (int i = 0; i < controllers.size(); i++)
+	PartitionRange<AnimationControllerComponent*> active = controllers.Active(activeScene);
+
+	for (int i = 0; i < active.size(); i++)
 	{
-		AnimationControllerComponent* c = controllers[i];
+		AnimationControllerComponent* c = active[i];
 
-		if (c->active && c->entity->Get_Scene() == activeScene ||
-			c->active && c->entity->Get_Scene() == 0)
+		if (c->active)
 		{
 
 			if (c->subID == playerAnimControllerSubID)
@@ -2369,12 +3319,11 @@ void AnimationControllerSystem::Update(int activeScene, float deltaTime)
 				// have the same set of components, aside from the player's.
 
 				PlayerAnimationControllerComponent* d = (PlayerAnimationControllerComponent*)c;
-				PhysicsComponent* p = (PhysicsComponent*)d->entity->componentIDMap[physicsComponentID];
-				ColliderComponent* col = (ColliderComponent*)d->entity->componentIDMap[colliderComponentID];
-				MovementComponent* move = (MovementComponent*)d->entity->componentIDMap[movementComponentID];
-				HealthComponent* health = (HealthComponent*)d->entity->componentIDMap[healthComponentID];
-				InputComponent* input = (InputComponent*)d->entity->componentIDMap[inputComponentID];
-				BladeComponent* blade = (BladeComponent*)input->moonlightBlade->componentIDMap[bladeComponentID];
+				PhysicsComponent* p = d->entity->Get<PhysicsComponent>();
+				ColliderComponent* col = d->entity->Get<ColliderComponent>();
+				MovementComponent* move = d->entity->Get<MovementComponent>();
+				HealthComponent* health = d->entity->Get<HealthComponent>();
+				InputComponent* input = d->entity->Get<InputComponent>();
 
 				if (!health->dead)
 				{
@@ -2456,19 +3405,22 @@ void AnimationControllerSystem::Update(int activeScene, float deltaTime)
 
 void AnimationControllerSystem::AddComponent(Component* component)
 {
-	controllers.push_back((AnimationControllerComponent*)component);
+	controllers.Add((AnimationControllerComponent*)component);
 }
 
 void AnimationControllerSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < controllers.size(); i++)
+	AnimationControllerComponent* s = e->Get<AnimationControllerComponent>();
+	controllers.Remove(s);
+
+	// Each kind of controller has its own pool, so we need to send it back to the right one.
+	if (s->subID == playerAnimControllerSubID)
 	{
-		if (controllers[i]->entity == e)
-		{
-			AnimationControllerComponent* s = controllers[i];
-			controllers.erase(std::remove(controllers.begin(), controllers.end(), s), controllers.end());
-			delete s;
-		}
+		ECS::Pool<PlayerAnimationControllerComponent>().Destroy((PlayerAnimationControllerComponent*)s);
+	}
+	else if (s->subID == moonlightBladeAnimControllerSubID)
+	{
+		ECS::Pool<MoonlightBladeAnimationControllerComponent>().Destroy((MoonlightBladeAnimationControllerComponent*)s);
 	}
 }
 
@@ -2478,67 +3430,37 @@ void AnimationControllerSystem::PurgeEntity(Entity* e)
 
 void AnimationSystem::Update(int activeScene, float deltaTime)
 {
-	std::sort(anims.begin(), anims.end(), [](AnimationComponent* a, AnimationComponent* b)
+	Gather(anims.Active(activeScene), drawList);
+
+	std::sort(drawList.begin(), drawList.end(), [](AnimationComponent* a, AnimationComponent* b)
 		{
 			return a->pos->z < b->pos->z;
 		});
 
-	for (int i = 0; i < anims.size(); i++)
-	{
-		// Animations work by taking a big-ass spritesheet
-		// and moving through the uvs by increments equal
-		// to one divided by the width and height of each sprite;
-		// this means we need to know how many such cells are in
-		// the whole sheet (for both rows and columns), so that
-		// we can feed the right cell coordinates into the
-		// renderer. This shouldn't be too difficult; the real
-		// question is how we'll manage conditions for different
-		// animations.
-		// We could just have a map containing strings and animations
-		// and set the active animation by calling some function, sending
-		// to that the name of the requested animation in the form of that
-		// string, but that doesn't seem like the ideal way to do it.
-		// We might try that first and then decide later whether
-		// there isn't a better way to handle this.
-
-		AnimationComponent* a = anims[i];
-
-		if (a->active && a->entity->Get_Scene() == activeScene ||
-			a->active && a->entity->Get_Scene() == 0)
+	// Advancing each animation's frame only touches that animation, so that part gets split up across threads;
+	// drawing them has to happen on this thread (and in order), so that's done afterwards.
+	ECS::main.scheduler.ParallelFor(drawList.size(), chunkSize, [&](int begin, int end)
 		{
-			a->lastTick += deltaTime;
-
-			Animation2D* activeAnimation = a->animations[a->activeAnimation];
-
-			int cellX = a->activeX, cellY = a->activeY;
-
-			if (activeAnimation->speed < a->lastTick)
+			for (int i = begin; i < end; i++)
 			{
-				a->lastTick = 0;
+				AnimationComponent* a = drawList[i];
 
-				if (a->activeX + 1 < activeAnimation->rowsToCols[cellY])
-				{
-					cellX = a->activeX += 1;
-				}
-				else
+				if (a->active)
 				{
-					if (activeAnimation->loop ||
-						a->activeY > 0)
-					{
-						cellX = a->activeX = 0;
-					}
-
-					if (a->activeY - 1 >= 0)
-					{
-						cellY = a->activeY -= 1;
-					}
-					else if (activeAnimation->loop)
-					{
-						cellX = a->activeX = 0;
-						cellY = a->activeY = activeAnimation->rows - 1;
-					}
+					Advance(a, deltaTime);
 				}
 			}
+		});
+
+	for (int i = 0; i < drawList.size(); i++)
+	{
+		AnimationComponent* a = drawList[i];
+
+		if (a->active)
+		{
+			Animation2D* activeAnimation = a->animations[a->activeAnimation];
+
+			int cellX = a->activeX, cellY = a->activeY;
 
 			PositionComponent* pos = a->pos;
 
@@ -2549,27 +3471,71 @@ void AnimationSystem::Update(int activeScene, float deltaTime)
 				// std::cout << std::to_string(activeAnimation->width) + "/" + std::to_string(activeAnimation->height) + "\n";
 				Game::main.renderer->prepareQuad(pos, activeAnimation->width, activeAnimation->height, a->scaleX, a->scaleY, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), activeAnimation->ID, a->mapTex->ID, cellX, cellY, activeAnimation->columns, activeAnimation->rows, a->flippedX, a->flippedY);
 			}
+		}
+	}
+}
+
+void AnimationSystem::Advance(AnimationComponent* a, float deltaTime)
+{
+	// Animations work by taking a big-ass spritesheet
+	// and moving through the uvs by increments equal
+	// to one divided by the width and height of each sprite;
+	// this means we need to know how many such cells are in
+	// the whole sheet (for both rows and columns), so that
+	// we can feed the right cell coordinates into the
+	// renderer. This shouldn't be too difficult; the real
+	// question is how we'll manage conditions for different
+	// animations.
+	// We could just have a map containing strings and animations
+	// and set the active animation by calling some function, sending
+	// to that the name of the requested animation in the form of that
+	// string, but that doesn't seem like the ideal way to do it.
+	// We might try that first and then decide later whether
+	// there isn't a better way to handle this.
+
+	a->lastTick += deltaTime;
+
+	Animation2D* activeAnimation = a->animations[a->activeAnimation];
+
+	if (activeAnimation->speed < a->lastTick)
+	{
+		a->lastTick = 0;
+
+		if (a->activeX + 1 < activeAnimation->rowsToCols[a->activeY])
+		{
+			a->activeX += 1;
+		}
+		else
+		{
+			if (activeAnimation->loop ||
+				a->activeY > 0)
+			{
+				a->activeX = 0;
+			}
 
+			if (a->activeY - 1 >= 0)
+			{
+				a->activeY -= 1;
+			}
+			else if (activeAnimation->loop)
+			{
+				a->activeX = 0;
+				a->activeY = activeAnimation->rows - 1;
+			}
 		}
 	}
 }
 
 void AnimationSystem::AddComponent(Component* component)
 {
-	anims.push_back((AnimationComponent*)component);
+	anims.Add((AnimationComponent*)component);
 }
 
 void AnimationSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < anims.size(); i++)
-	{
-		if (anims[i]->entity == e)
-		{
-			AnimationComponent* s = anims[i];
-			anims.erase(std::remove(anims.begin(), anims.end(), s), anims.end());
-			delete s;
-		}
-	}
+	AnimationComponent* s = e->Get<AnimationComponent>();
+	anims.Remove(s);
+	ECS::Pool<AnimationComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -2578,12 +3544,13 @@ void AnimationSystem::PurgeEntity(Entity* e)
 
 void HealthSystem::Update(int activeScene, float deltaTime)
 {
-	for (int i = 0; i < healths.size(); i++)
+	PartitionRange<HealthComponent*> active = healths.Active(activeScene);
+
+	for (int i = 0; i < active.size(); i++)
 	{
-		HealthComponent* h = healths[i];
+		HealthComponent* h = active[i];
 
-		if (h->active && h->entity->Get_Scene() == activeScene ||
-			h->active && h->entity->Get_Scene() == 0)
+		if (h->active)
 		{
 			if (h->health <= 0.0f)
 			{
@@ -2591,7 +3558,7 @@ void HealthSystem::Update(int activeScene, float deltaTime)
 				h->dead = true;
 
 				h->active = false;
-				ECS::main.AddDeadEntity(h->entity);
+				ECS::main.Commands().DestroyEntity(h->entity);
 			}
 		}
 	}
@@ -2599,20 +3566,14 @@ void HealthSystem::Update(int activeScene, float deltaTime)
 
 void HealthSystem::AddComponent(Component* component)
 {
-	healths.push_back((HealthComponent*)component);
+	healths.Add((HealthComponent*)component);
 }
 
 void HealthSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < healths.size(); i++)
-	{
-		if (healths[i]->entity == e)
-		{
-			HealthComponent* s = healths[i];
-			healths.erase(std::remove(healths.begin(), healths.end(), s), healths.end());
-			delete s;
-		}
-	}
+	HealthComponent* s = e->Get<HealthComponent>();
+	healths.Remove(s);
+	ECS::Pool<HealthComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -2627,17 +3588,17 @@ void ParticleSystem::Update(int activeScene, float deltaTime)
 	float screenTop = (Game::main.camY + (Game::main.windowHeight * Game::main.zoom / 1.0f));
 	float screenElev = Game::main.camZ;
 
-	for (int i = 0; i < particles.size(); i++)
+	PartitionRange<tuple<ParticleComponent*, PositionComponent*>> view = ECS::main.View<ParticleComponent, PositionComponent>().Active(activeScene);
+
+	for (int i = 0; i < view.size(); i++)
 	{
-		ParticleComponent* p = particles[i];
+		auto [p, pos] = view[i];
 
-		if (p->active && p->entity->Get_Scene() == activeScene ||
-			p->active && p->entity->Get_Scene() == 0)
+		if (p->active)
 		{
 			if (p->lastTick >= p->tickRate)
 			{
 				p->lastTick = 0.0f;
-				PositionComponent* pos = (PositionComponent*)p->entity->componentIDMap[positionComponentID];
 				glm::vec2 pPos = glm::vec2(pos->x + p->xOffset, pos->y + p->yOffset);
 
 				if (pPos.x > screenLeft && pPos.x < screenRight &&
@@ -2658,20 +3619,14 @@ void ParticleSystem::Update(int activeScene, float deltaTime)
 
 void ParticleSystem::AddComponent(Component* component)
 {
-	particles.push_back((ParticleComponent*)component);
+	particles.Add((ParticleComponent*)component);
 }
 
 void ParticleSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < particles.size(); i++)
-	{
-		if (particles[i]->entity == e)
-		{
-			ParticleComponent* s = particles[i];
-			particles.erase(std::remove(particles.begin(), particles.end(), s), particles.end());
-			delete s;
-		}
-	}
+	ParticleComponent* s = e->Get<ParticleComponent>();
+	particles.Remove(s);
+	ECS::Pool<ParticleComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -2680,16 +3635,17 @@ void ParticleSystem::PurgeEntity(Entity* e)
 
 void DamageSystem::Update(int activeScene, float deltaTime)
 {
-	for (int i = 0; i < damagers.size(); i++)
+	PartitionRange<DamageComponent*> active = damagers.Active(activeScene);
+
+	for (int i = 0; i < active.size(); i++)
 	{
-		DamageComponent* d = damagers[i];
+		DamageComponent* d = active[i];
 
-		if (d->active && d->entity->Get_Scene() == activeScene ||
-			d->active && d->entity->Get_Scene() == 0)
+		if (d->active)
 		{
 			if (d->hasLifetime && d->lifetime < 0.0f)
 			{
-				ECS::main.AddDeadEntity(d->entity);
+				ECS::main.Commands().DestroyEntity(d->entity);
 			}
 			else if (d->hasLifetime)
 			{
@@ -2701,20 +3657,14 @@ void DamageSystem::Update(int activeScene, float deltaTime)
 
 void DamageSystem::AddComponent(Component* component)
 {
-	damagers.push_back((DamageComponent*)component);
+	damagers.Add((DamageComponent*)component);
 }
 
 void DamageSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < damagers.size(); i++)
-	{
-		if (damagers[i]->entity == e)
-		{
-			DamageComponent* s = damagers[i];
-			damagers.erase(std::remove(damagers.begin(), damagers.end(), s), damagers.end());
-			delete s;
-		}
-	}
+	DamageComponent* s = e->Get<DamageComponent>();
+	damagers.Remove(s);
+	ECS::Pool<DamageComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -2723,19 +3673,25 @@ void DamageSystem::PurgeEntity(Entity* e)
 
 void AISystem::Update(int activeScene, float deltaTime)
 {
-	for (int i = 0; i < ai.size(); i++)
+	PartitionRange<tuple<AIComponent*, PositionComponent*>> view = ECS::main.View<AIComponent, PositionComponent>().Active(activeScene);
+
+	for (int i = 0; i < view.size(); i++)
 	{
-		AIComponent* a = ai[i];
+		auto [a, posA] = view[i];
 
-		if (a->active && a->entity->Get_Scene() == activeScene ||
-			a->active && a->entity->Get_Scene() == 0)
+		if (a->active)
 		{
-			Entity* player = ECS::main.player;
-			
+			// If the player's dead and gone, there's no one left to chase.
+			Entity* player = ECS::main.GetEntity(ECS::main.player);
+
+			if (player == nullptr)
+			{
+				continue;
+			}
+
 			if (a->aiType == AIType::aerial)
 			{
-				PositionComponent* posA = (PositionComponent*)a->entity->componentIDMap[positionComponentID];
-				PositionComponent* posB = (PositionComponent*)player->componentIDMap[positionComponentID];
+				PositionComponent* posB = player->Get<PositionComponent>();
 
 				glm::vec2 aCoor = glm::vec2(posA->x, posA->y);
 				glm::vec2 lookRay = aCoor - glm::vec2(posB->x, posB->y);
@@ -2748,30 +3704,25 @@ void AISystem::Update(int activeScene, float deltaTime)
 					bool blocked = false;
 					if (!a->proc)
 					{
-						int myID = a->entity->Get_ID();
-						int playerID = player->Get_ID();
+						uint32_t myID = a->entity->Get_ID();
+						uint32_t playerID = player->Get_ID();
 
-						for (int en = 0; en < ECS::main.entities.size(); en++)
-						{
-							PositionComponent* posC = (PositionComponent*)ECS::main.entities[en]->componentIDMap[positionComponentID];
-							ColliderComponent* colC = (ColliderComponent*)ECS::main.entities[en]->componentIDMap[colliderComponentID];
+						// Any solid collider between us and the player blocks our line of sight, so we cast from us towards them
+						// and see whether anything other than the two of us is in the way.
+						ColliderSystem* colliders = (ColliderSystem*)ECS::main.blocksByID[colliderComponentID]->system;
 
-							if (colC != nullptr)
-							{
-								int colID = colC->entity->Get_ID();
+						sightHits.clear();
+						colliders->Raycast(activeScene, aCoor.x, aCoor.y, posB->x, posB->y, sightHits);
 
-								if (colC->active && !colC->trigger && colID != playerID && colID != myID)
-								{
-									glm::vec2 cp = glm::vec2(0, 0);
-									glm::vec2 cn = glm::vec2(0, 0);
-									float t = 0.0f;
+						for (int en = 0; en < sightHits.size(); en++)
+						{
+							ColliderComponent* colC = sightHits[en].collider;
+							uint32_t colID = colC->entity->Get_ID();
 
-									if (RayOverlapRect(aCoor, lookRay, glm::vec2(posC->x + colC->offsetX, posC->y + colC->offsetY), colC->width, colC->height, cp, cn, t))
-									{
-										blocked = true;
-										break;
-									}
-								}
+							if (!colC->trigger && colID != playerID && colID != myID)
+							{
+								blocked = true;
+								break;
 							}
 						}
 					}
@@ -2784,18 +3735,15 @@ void AISystem::Update(int activeScene, float deltaTime)
 						{
 							a->lastAttack = 0.0f;
 
-							Texture2D* s = Game::main.textureMap["bullet"];
-							Texture2D* sMap = Game::main.textureMap["aether_bullet"];
-
-							Entity* projectile = ECS::main.CreateEntity(0, "Bullet");
+							Prefab* bulletPrefab = ECS::main.GetPrefab("aether bullet");
 
-							glm::vec2 vel = -Normalize(lookRay) * a->projectileSpeed;
+							PrefabInstance bullet;
+							bullet.position = glm::vec3(posA->x, posA->y, posA->z);
+							bullet.velocity = -Normalize(lookRay) * a->projectileSpeed;
+							bullet.owner = a->entity->Get_Handle();
 
-							ECS::main.RegisterComponent(new PositionComponent(projectile, true, false, posA->x, posA->y, posA->z, 0.0f), projectile);
-							ECS::main.RegisterComponent(new PhysicsComponent(projectile, true, (PositionComponent*)projectile->componentIDMap[positionComponentID], vel.x, vel.y, 0.0f, 0.0f, 0.0f), projectile);
-							ECS::main.RegisterComponent(new ColliderComponent(projectile, true, (PositionComponent*)projectile->componentIDMap[positionComponentID], false, false, true, false, true, false, true, EntityClass::object, 1.0f, 0.0f, 0.0f, 5.0f, 5.0f, 0.0f, 0.0f), projectile);
-							ECS::main.RegisterComponent(new DamageComponent(projectile, true, a->entity, true, 10.0f, false, true, 1, 10.0f, true, true, true, false), projectile);
-							ECS::main.RegisterComponent(new StaticSpriteComponent(projectile, true, (PositionComponent*)projectile->componentIDMap[positionComponentID], s->width, s->height, 1.0f, 1.0f, s, sMap, false, false, false, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)), projectile);
+							// The bullet doesn't actually show up until the end of the frame, once every system is done.
+							ECS::main.Commands().Instantiate(bulletPrefab, bullet);
 						}
 						else
 						{
@@ -2810,20 +3758,14 @@ void AISystem::Update(int activeScene, float deltaTime)
 
 void AISystem::AddComponent(Component* component)
 {
-	ai.push_back((AIComponent*)component);
+	ai.Add((AIComponent*)component);
 }
 
 void AISystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < ai.size(); i++)
-	{
-		if (ai[i]->entity == e)
-		{
-			AIComponent* s = ai[i];
-			ai.erase(std::remove(ai.begin(), ai.end(), s), ai.end());
-			delete s;
-		}
-	}
+	AIComponent* s = e->Get<AIComponent>();
+	ai.Remove(s);
+	ECS::Pool<AIComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -2832,21 +3774,25 @@ void AISystem::PurgeEntity(Entity* e)
 
 void BladeSystem::Update(int activeScene, float deltaTime)
 {
-	for (int i = 0; i < blades.size(); i++)
+	PartitionRange<tuple<BladeComponent*, ColliderComponent*, DamageComponent*, PhysicsComponent*, PositionComponent*, AnimationComponent*>> view = ECS::main.View<BladeComponent, ColliderComponent, DamageComponent, PhysicsComponent, PositionComponent, AnimationComponent>().Active(activeScene);
+
+	for (int i = 0; i < view.size(); i++)
 	{
-		BladeComponent* b = blades[i];
+		auto [b, colA, damA, physA, posA, anim] = view[i];
 
-		if (b->active && b->entity->Get_Scene() == activeScene ||
-			b->active && b->entity->Get_Scene() == 0)
+		if (b->active)
 		{
-			ColliderComponent* colA = (ColliderComponent*)b->entity->componentIDMap[colliderComponentID];
-			DamageComponent* damA = (DamageComponent*)b->entity->componentIDMap[damageComponentID];
-			PhysicsComponent* physA = (PhysicsComponent*)b->entity->componentIDMap[physicsComponentID];
-			PositionComponent* posA = (PositionComponent*)b->entity->componentIDMap[positionComponentID];
-			AnimationComponent* anim = (AnimationComponent*)b->entity->componentIDMap[animationComponentID];
 			
-			Entity* player = ECS::main.player;
-			PositionComponent* posB = (PositionComponent*)player->componentIDMap[positionComponentID];
+			Entity* player = ECS::main.GetEntity(ECS::main.player);
+			Entity* hilt = ECS::main.GetEntity(b->hilt);
+
+			if (player == nullptr || hilt == nullptr)
+			{
+				continue;
+			}
+
+			PositionComponent* posB = player->Get<PositionComponent>();
+			ColliderComponent* platformCollider = hilt->Get<ColliderComponent>();
 
 			if (damA->lodged)
 			{
@@ -2859,11 +3805,11 @@ void BladeSystem::Update(int activeScene, float deltaTime)
 				anim->mapTex = b->incorporealMap;
 				colA->active = false;
 				damA->active = false;
-				b->platformCollider->active = false;
+				platformCollider->active = false;
 
-				PhysicsComponent* physB = (PhysicsComponent*)player->componentIDMap[physicsComponentID];
-				ColliderComponent* colB = (ColliderComponent*)player->componentIDMap[colliderComponentID];
-				MovementComponent* moveB = (MovementComponent*)player->componentIDMap[movementComponentID];
+				PhysicsComponent* physB = player->Get<PhysicsComponent>();
+				ColliderComponent* colB = player->Get<ColliderComponent>();
+				MovementComponent* moveB = player->Get<MovementComponent>();
 
 				glm::vec2 position = glm::vec2(posA->x, posA->y);
 				glm::vec2 mouse = glm::vec2(Game::main.mouseX, Game::main.mouseY);
@@ -2892,10 +3838,10 @@ void BladeSystem::Update(int activeScene, float deltaTime)
 				// I'll need to change this later if I want this to handle animations.
 				float r = std::atan2(mouse.y - position.y, mouse.x - position.x) * (180 / M_PI);
 
-				if (glfwJoystickIsGamepad(GLFW_JOYSTICK_1))
+				GLFWgamepadstate state;
+
+				if (Game::main.input->Gamepad(state))
 				{
-					GLFWgamepadstate state;
-					glfwGetGamepadState(GLFW_JOYSTICK_1, &state);
 
 					bool swordRotRight =		(Game::main.swordRotRightPadType == InputType::trigger && state.axes[Game::main.swordRotRightPad] + 1 ||
 												Game::main.swordRotRightPadType == InputType::stickPos && state.axes[Game::main.swordRotRightPad] > 0.1f ||
@@ -2994,45 +3940,45 @@ void BladeSystem::Update(int activeScene, float deltaTime)
 				physA->gravityMod = 0;
 				// Act as a grappling hook?
 
-				if (b->platformCollider->active == false && posA->rotation < 15.0f && posA->rotation > -15.0f ||
-					b->platformCollider->active == false && posA->rotation > 345.0f)
+				if (platformCollider->active == false && posA->rotation < 15.0f && posA->rotation > -15.0f ||
+					platformCollider->active == false && posA->rotation > 345.0f)
 				{
 					anim->mapTex = b->corporealMap;
-					PositionComponent* hiltPos = (PositionComponent*)b->platformCollider->entity->componentIDMap[positionComponentID];
+					PositionComponent* hiltPos = hilt->Get<PositionComponent>();
 					hiltPos->x = posA->x;
 					hiltPos->y = posA->y;
-					b->platformCollider->active = true;
+					platformCollider->active = true;
 
-					b->platformCollider->width = 35.0f;
-					b->platformCollider->height = 5.0f;
-					b->platformCollider->platform = true;
-					b->platformCollider->onewayPlatform = true;
+					platformCollider->width = 35.0f;
+					platformCollider->height = 5.0f;
+					platformCollider->platform = true;
+					platformCollider->onewayPlatform = true;
 
 					if (anim->flippedX)
 					{
-						b->platformCollider->offsetX = 20.0f;
+						platformCollider->offsetX = 20.0f;
 					}
 					else
 					{
-						b->platformCollider->offsetX = -20.0f;
+						platformCollider->offsetX = -20.0f;
 					}
 				}
-				else if (b->platformCollider->active == false && posA->rotation < -75.0f ||
-						 b->platformCollider->active == false && anim->flippedX && posA->rotation > 75.0f)
+				else if (platformCollider->active == false && posA->rotation < -75.0f ||
+						 platformCollider->active == false && anim->flippedX && posA->rotation > 75.0f)
 				{
 					anim->mapTex = b->corporealMap;
-					PositionComponent* hiltPos = (PositionComponent*)b->platformCollider->entity->componentIDMap[positionComponentID];
+					PositionComponent* hiltPos = hilt->Get<PositionComponent>();
 					hiltPos->x = posA->x;
 					hiltPos->y = posA->y;
-					b->platformCollider->active = true;
+					platformCollider->active = true;
 
-					b->platformCollider->platform = true;
-					b->platformCollider->onewayPlatform = false;
-					b->platformCollider->width = 5.0f;
-					b->platformCollider->height = 70.0f;
+					platformCollider->platform = true;
+					platformCollider->onewayPlatform = false;
+					platformCollider->width = 5.0f;
+					platformCollider->height = 70.0f;
 
-					b->platformCollider->offsetX = 0.0f;
-					b->platformCollider->offsetY = 0.0f;
+					platformCollider->offsetX = 0.0f;
+					platformCollider->offsetY = 0.0f;
 				}
 			}
 			else
@@ -3040,7 +3986,7 @@ void BladeSystem::Update(int activeScene, float deltaTime)
 				// We are in flight.
 				posA->z = -10.0f;
 				ParticleEngine::main.AddParticles(1, physA->pos->x, physA->pos->y, 0, Element::aether, rand() % 10 + 1);
-				b->platformCollider->active = false;
+				platformCollider->active = false;
 				colA->active = true;
 				damA->active = true;
 			}
@@ -3050,20 +3996,14 @@ void BladeSystem::Update(int activeScene, float deltaTime)
 
 void BladeSystem::AddComponent(Component* component)
 {
-	blades.push_back((BladeComponent*)component);
+	blades.Add((BladeComponent*)component);
 }
 
 void BladeSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < blades.size(); i++)
-	{
-		if (blades[i]->entity == e)
-		{
-			BladeComponent* s = blades[i];
-			blades.erase(std::remove(blades.begin(), blades.end(), s), blades.end());
-			delete s;
-		}
-	}
+	BladeComponent* s = e->Get<BladeComponent>();
+	blades.Remove(s);
+	ECS::Pool<BladeComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -3072,14 +4012,20 @@ void BladeSystem::PurgeEntity(Entity* e)
 
 void ImageSystem::Update(int activeScene, float deltaTime)
 {
-	for (int i = 0; i < images.size(); i++)
+	PartitionRange<tuple<ImageComponent*, PositionComponent*>> view = ECS::main.View<ImageComponent, PositionComponent>().Active(activeScene);
+
+	glm::vec4 cameraView = glm::vec4(Game::main.leftX, Game::main.rightX, Game::main.topY, Game::main.bottomY);
+	bool cameraMoved = cameraView != lastView || Game::main.zoom != lastZoom;
+
+	lastView = cameraView;
+	lastZoom = Game::main.zoom;
+
+	for (int i = 0; i < view.size(); i++)
 	{
-		ImageComponent* img = images[i];
+		auto [img, pos] = view[i];
 
-		if (img->active && img->entity->Get_Scene() == activeScene ||
-			img->active && img->entity->Get_Scene() == 0)
+		if (img->active && (cameraMoved || img->ChangedSince(lastRun)))
 		{
-			PositionComponent* pos = (PositionComponent*)img->entity->componentIDMap[positionComponentID];
 
 			glm::vec2 anchorPos;
 
@@ -3105,12 +4051,14 @@ void ImageSystem::Update(int activeScene, float deltaTime)
 
 			pos->x = anchorPos.x + img->x;
 			pos->y = anchorPos.y + img->y;
+			pos->MarkChanged();
 
-			StaticSpriteComponent* sprite = (StaticSpriteComponent*)img->entity->componentIDMap[spriteComponentID];
+			StaticSpriteComponent* sprite = img->entity->Get<StaticSpriteComponent>();
 			if (sprite != nullptr)
 			{
 				sprite->scaleX = spriteScaleX;
 				sprite->scaleY = spriteScaleY;
+				sprite->MarkChanged();
 			}
 		}
 	}
@@ -3118,20 +4066,14 @@ void ImageSystem::Update(int activeScene, float deltaTime)
 
 void ImageSystem::AddComponent(Component* component)
 {
-	images.push_back((ImageComponent*)component);
+	images.Add((ImageComponent*)component);
 }
 
 void ImageSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < images.size(); i++)
-	{
-		if (images[i]->entity == e)
-		{
-			ImageComponent* s = images[i];
-			images.erase(std::remove(images.begin(), images.end(), s), images.end());
-			delete s;
-		}
-	}
+	ImageComponent* s = e->Get<ImageComponent>();
+	images.Remove(s);
+	ECS::Pool<ImageComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -3140,39 +4082,39 @@ void ImageSystem::PurgeEntity(Entity* e)
 
 void ButtonSystem::Update(int activeScene, float deltaTime)
 {
-	std::sort(buttons.begin(), buttons.end(), [](ButtonComponent* a, ButtonComponent* b)
+	Gather(buttons.Active(activeScene), sorted);
+
+	std::sort(sorted.begin(), sorted.end(), [](ButtonComponent* a, ButtonComponent* b)
 		{
-			PositionComponent* posA = (PositionComponent*)a->entity->componentIDMap[positionComponentID];
-			PositionComponent* posB = (PositionComponent*)b->entity->componentIDMap[positionComponentID];
+			PositionComponent* posA = a->entity->Get<PositionComponent>();
+			PositionComponent* posB = b->entity->Get<PositionComponent>();
 			return posA->z > posB->z;
 		});
 
 	bool hovered = false;
 
-	for (int i = 0; i < buttons.size(); i++)
+	for (int i = 0; i < sorted.size(); i++)
 	{
-		ButtonComponent* b = buttons[i];
+		ButtonComponent* b = sorted[i];
 
-		if (b->active && b->entity->Get_Scene() == activeScene ||
-			b->active && b->entity->Get_Scene() == 0)
+		if (b->active)
 		{
-			bool click = ((glfwGetKey(Game::main.window, Game::main.clickKey) == GLFW_PRESS) || (glfwGetMouseButton(Game::main.window, Game::main.clickKey) == GLFW_PRESS));
+			bool click = Game::main.input->Held(Game::main.clickKey);
 
-			if (glfwJoystickIsGamepad(GLFW_JOYSTICK_1))
+			GLFWgamepadstate state;
+
+			if (Game::main.input->Gamepad(state))
 			{
 				Game::main.usingGamepad = true;
 
-				GLFWgamepadstate state;
-				glfwGetGamepadState(GLFW_JOYSTICK_1, &state);
-
 				if (!click) click = (Game::main.clickPadType == InputType::trigger && state.axes[Game::main.clickPad] + 1 ||
 					Game::main.clickPadType == InputType::stickPos && state.axes[Game::main.clickPad] > 0.1f ||
 					Game::main.clickPadType == InputType::stickNeg && state.axes[Game::main.clickPad] < -0.1f ||
 					Game::main.clickPadType == InputType::button && state.buttons[Game::main.clickPad]);
 			}
 
-			PositionComponent* pos = (PositionComponent*)b->entity->componentIDMap[positionComponentID];
-			StaticSpriteComponent* sprite = (StaticSpriteComponent*)b->entity->componentIDMap[spriteComponentID];
+			PositionComponent* pos = b->entity->Get<PositionComponent>();
+			StaticSpriteComponent* sprite = b->entity->Get<StaticSpriteComponent>();
 
 			bool overlap = PointOverlapRect(glm::vec2(Game::main.mouseX, Game::main.mouseY), glm::vec2(pos->x, pos->y), b->width * sprite->scaleX, b->height * sprite->scaleY);
 
@@ -3241,11 +4183,15 @@ bool ButtonSystem::CheckButtonReqs(ButtonComponent* b)
 	{
 		for (int j = 0; j < b->requiredButtons[i].size(); j++)
 		{
-			if (!b->requiredButtons[i][j]->clicked && b->needsAllReqs)
+			// A button that no longer exists can't very well be clicked.
+			ButtonComponent* req = GetButton(b->requiredButtons[i][j]);
+			bool clicked = (req != nullptr && req->clicked);
+
+			if (!clicked && b->needsAllReqs)
 			{
 				return false;
 			}
-			else if (b->requiredButtons[i][j]->clicked && !b->needsAllReqs)
+			else if (clicked && !b->needsAllReqs)
 			{
 				reqCategoriesMet++;
 			}
@@ -3259,7 +4205,8 @@ bool ButtonSystem::CheckButtonReqs(ButtonComponent* b)
 
 	for (int i = 0; i < b->illegalButtons.size(); i++)
 	{
-		if (b->illegalButtons[i]->clicked) return false;
+		ButtonComponent* illegal = GetButton(b->illegalButtons[i]);
+		if (illegal != nullptr && illegal->clicked) return false;
 	}
 
 	return reqsMet;
@@ -3269,29 +4216,37 @@ void ButtonSystem::ToggleExclusiveButtons(ButtonComponent* b, bool click)
 {
 	for (int i = 0; i < b->exclusiveButtons.size(); i++)
 	{
-		if (b->exclusiveButtons[i] != b)
+		ButtonComponent* other = GetButton(b->exclusiveButtons[i]);
+
+		if (other != nullptr && other != b)
 		{
-			b->exclusiveButtons[i]->clicked = !click;
+			other->clicked = !click;
 		}
 	}
 }
 
+ButtonComponent* ButtonSystem::GetButton(EntityHandle handle)
+{
+	Entity* e = ECS::main.GetEntity(handle);
+
+	if (e == nullptr)
+	{
+		return nullptr;
+	}
+
+	return e->Get<ButtonComponent>();
+}
+
 void ButtonSystem::AddComponent(Component* component)
 {
-	buttons.push_back((ButtonComponent*)component);
+	buttons.Add((ButtonComponent*)component);
 }
 
 void ButtonSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < buttons.size(); i++)
-	{
-		if (buttons[i]->entity == e)
-		{
-			ButtonComponent* s = buttons[i];
-			buttons.erase(std::remove(buttons.begin(), buttons.end(), s), buttons.end());
-			delete s;
-		}
-	}
+	ButtonComponent* s = e->Get<ButtonComponent>();
+	buttons.Remove(s);
+	ECS::Pool<ButtonComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -3300,14 +4255,20 @@ void ButtonSystem::PurgeEntity(Entity* e)
 
 void TextRenderingSystem::Update(int activeScene, float deltaTime)
 {
-	for (int i = 0; i < texts.size(); i++)
+	// There's no text renderer in a headless run (there's no GL to render it with).
+	if (Game::main.textRenderer == nullptr)
+	{
+		return;
+	}
+
+	PartitionRange<tuple<TextComponent*, PositionComponent*>> view = ECS::main.View<TextComponent, PositionComponent>().Active(activeScene);
+
+	for (int i = 0; i < view.size(); i++)
 	{
-		TextComponent* t = texts[i];
+		auto [t, pos] = view[i];
 
-		if (t->active && t->entity->Get_Scene() == activeScene ||
-			t->active && t->entity->Get_Scene() == 0)
+		if (t->active)
 		{
-			PositionComponent* pos = (PositionComponent*)t->entity->componentIDMap[positionComponentID];
 
 			if (pos->x + (t->boxWidth * t->scaleX / 2.0f) > Game::main.leftX && pos->x - (t->boxWidth * t->scaleX / 2.0f) < Game::main.rightX &&
 				pos->y + (t->boxHeight * t->scaleY / 2.0f) > Game::main.bottomY && pos->y - (t->boxHeight * t->scaleY / 2.0f) < Game::main.topY &&
@@ -3323,20 +4284,14 @@ void TextRenderingSystem::Update(int activeScene, float deltaTime)
 
 void TextRenderingSystem::AddComponent(Component* component)
 {
-	texts.push_back((TextComponent*)component);
+	texts.Add((TextComponent*)component);
 }
 
 void TextRenderingSystem::PurgeEntity(Entity* e)
 {
-	for (int i = 0; i < texts.size(); i++)
-	{
-		if (texts[i]->entity == e)
-		{
-			TextComponent* s = texts[i];
-			texts.erase(std::remove(texts.begin(), texts.end(), s), texts.end());
-			delete s;
-		}
-	}
+	TextComponent* s = e->Get<TextComponent>();
+	texts.Remove(s);
+	ECS::Pool<TextComponent>().Destroy(s);
 }
 
 #pragma endregion
@@ -3349,14 +4304,16 @@ void TriggerObserver::Trigger()
 {
 	for (int i = 0; i < buttons.size(); i++)
 	{
-		if (buttons[i]->clicked)
+		ButtonComponent* b = ButtonSystem::GetButton(buttons[i]);
+
+		if (b != nullptr && b->clicked)
 		{
-			for (int j = 0; j < buttons[i]->observers.size(); j++)
+			for (int j = 0; j < b->observers.size(); j++)
 			{
-				buttons[i]->observers[j]->Trigger();
+				b->observers[j]->Trigger();
 			}
 
-			buttons[i]->clicked = false;
+			b->clicked = false;
 		}
 	}
 }
@@ -12,12 +12,14 @@
 // In short, when the game starts, the ECS hub runs its Init() function, where we create systems and component blocks and assign the former to the latter.
 // Then, Main calls the ECS hub's update function which in turn calls the update function on each component block which in turn calls the update function on each system.
 // There, the system loops through each component and applies some logic to it.
-// To add a new component, one calls the RegisterComponent() function and passes in the component and its entity.
+// To add a new component, one calls the AddComponent() function with the component's type and constructor arguments;
+// this grabs a slot for it from that type's pool and then passes it (and its entity) to RegisterComponent().
 // Then, the ECS hub takes this and determines---via the component ID---which component block it belongs to.
 // It calls the AddComponent() function in the block which then calls the AddComponent() function in the system
 // which finally converts the abstract component into its respective type and adds it to its component list (and then iterates over it during its update).
 
-// In short, if one adds a new component, one needs to assign it a new component ID in component.h, then add it to the forward declarations in system.h.
+// In short, if one adds a new component, one needs to assign it a new component ID in component.h (and map its type to that ID with a ComponentId<> specialization),
+// then add it to the forward declarations in system.h.
 // Then, if necessary, one can create a system to manage that component. This involves adding it to system.h, then defining it in the last section of ecs.cpp,
 // then one needs to go to the ECS section of ecs.cpp and instantiate the system (and its respective component block) in the Init() function.
 // This might sound complicated, but it really honestly isn't (though I will say this is probably more complicated than it needs to be).
@@ -27,12 +29,24 @@
 
 #include <vector>
 #include <map>
+#include <mutex>
+#include <cmath>
+#include <functional>
+#include <string>
+#include "componentpool.h"
+#include "entity.h"
+#include "view.h"
+#include "scheduler.h"
+#include "registry.h"
 
 using namespace std;
 
 class Entity;
 class System;
 class Component;
+class EntityCommandBuffer;
+class Prefab;
+struct PrefabInstance;
 
 #pragma region Nodes
 
@@ -88,27 +102,233 @@ public:
 class ECS
 {
 private:
-	uint32_t entityIDCounter = 0;
 	int round = 0;
 
+	// This is the slot table; an entity handle's index points into these.
+	// Entities are never actually deleted: when one dies, its slot's generation goes up
+	// and the slot goes on the free list, and the next entity created reuses the same Entity object.
+	vector<Entity*> slots;
+	vector<uint32_t> generations;
+	vector<uint32_t> freeSlots;
+
+	// Systems running on different threads can mark entities for death (or ask for a view for the first time) at the same time.
+	std::mutex dyingLock;
+	std::mutex viewLock;
+	std::mutex commandLock;
+
+	// Every thread that's ever recorded a command has a buffer in here.
+	vector<EntityCommandBuffer*> commandBuffers;
+
+	// Bumps the generation of an entity's slot, which invalidates every handle still pointing at it.
+	void Retire(uint32_t index);
+
 public:
 	static ECS main;
 	int activeScene = 0;
-	Entity* player;
+	EntityHandle player;
+
+	// Every live entity, indexed by name and tag (see registry.h).
+	EntityRegistry registry;
 
-	vector<Entity*> entities;
 	vector<Entity*> dyingEntities;
 
+	// One bit per entity slot telling us whether the entity is already on the dying list.
+	vector<bool> dying;
+
 	vector<ComponentBlock*> componentBlocks;
 
-	uint32_t GetID();
+	// The same component blocks, indexed by the ID of the component they hold.
+	vector<ComponentBlock*> blocksByID;
+
+	// Every view that's been asked for so far; they get told whenever an entity gains the components they want or dies.
+	vector<ViewBase*> views;
+
+	// This runs the component blocks' systems every frame (see scheduler.h).
+	Scheduler scheduler;
+
+	// The simulation's fixed step (in seconds), the most steps we'll take in one frame to catch up,
+	// the time we still owe the simulation, and how far that is through the next step (which is what rendering uses to interpolate).
+	float fixedStep = 1.0f / 120.0f;
+	int maxSteps = 5;
+	float accumulator = 0.0f;
+	float interpolation = 0.0f;
+
+	// Whether the first update builds the starting level.
+	bool loadLevel = true;
+
+	// Every prefab, by name (see prefab.h).
+	map<std::string, Prefab*> prefabs;
+
+	EntityHandle GetID();
+	Entity* GetEntity(EntityHandle handle);
+	bool IsAlive(EntityHandle handle) { return GetEntity(handle) != nullptr; }
 	void Init();
 	void Update(float deltaTime);
+	void SetSimulationRate(float stepsPerSecond, int maxSteps);
 	Entity* CreateEntity(int scene, std::string name);
 	void DeleteEntity(Entity* e);
 	void AddDeadEntity(Entity* e);
 	void PurgeDeadEntities();
-	void RegisterComponent(Component* component, Entity* entity);
+	// Returns false (and leaves everything as it was) if the entity already has a component of that type.
+	bool RegisterComponent(Component* component, Entity* entity);
+	void DuplicateComponent(Entity* entity, int componentID);
+	void RemoveComponent(Entity* entity, int componentID);
+
+	// These are how recycled prefabs (see prefab.h) take their dead entities out of play and bring them back;
+	// a parked entity keeps its slot and its components, but is out of every view and has a stale handle until it's revived.
+	void ParkEntity(Entity* e);
+	void ReviveEntity(Entity* e);
+	void UnparkEntity(Entity* e);
+
+	Prefab* DefinePrefab(std::string name, int scene);
+	Prefab* GetPrefab(std::string name);
+	void DefinePrefabs();
+
+	// Systems shouldn't create entities or add and remove components in the middle of their updates
+	// (other systems might be looping over the very lists they'd be changing); instead, they record what they want done
+	// in the current thread's command buffer, and it all gets done at once after every system has finished.
+	EntityCommandBuffer& Commands();
+	void PlaybackCommands();
+
+	// Since every system only looks at the global scene's partition and the active scene's,
+	// switching scenes doesn't touch any components at all; the old scene just stays resident until it's needed again.
+	void SetActiveScene(int scene);
+
+	// Every component type gets its own pool; components should be created through AddComponent
+	// (which takes the same arguments as the component's constructor) and handed back to their pool
+	// when their system purges them.
+	template <typename T>
+	static ComponentPool<T>& Pool()
+	{
+		static ComponentPool<T> pool;
+		return pool;
+	}
+
+	template <typename T, typename... Args>
+	T* AddComponent(Entity* entity, Args&&... args)
+	{
+		if (entity->Has<T>())
+		{
+			// A recycled entity still has its old components, so those just get rebuilt where they are.
+			if (entity->parked)
+			{
+				return Reinitialize(entity->Get<T>(), entity, std::forward<Args>(args)...);
+			}
+
+			// Anyone else asking for a second one gets the one it already has (see RegisterComponent()).
+			DuplicateComponent(entity, ComponentId<T>());
+			return entity->Get<T>();
+		}
+
+		T* component = Pool<T>().Create(entity, std::forward<Args>(args)...);
+		RegisterComponent(component, entity);
+		return component;
+	}
+
+	// Runs a component's constructor again in the slot it already has; it keeps its place in its system's list.
+	template <typename T, typename... Args>
+	T* Reinitialize(T* component, Args&&... args)
+	{
+		int denseIndex = component->denseIndex;
+		int partition = component->partition;
+
+		component->~T();
+		new (component) T(std::forward<Args>(args)...);
+
+		component->denseIndex = denseIndex;
+		component->partition = partition;
+		return component;
+	}
+
+	// Returns the view of every entity with all of the given components (see view.h).
+	// The first time a view is asked for, we fill it with whatever entities already qualify.
+	template <typename... Ts>
+	ComponentView<Ts...>& View()
+	{
+		static ComponentView<Ts...>* view = static_cast<ComponentView<Ts...>*>(AddView(new ComponentView<Ts...>()));
+		return *view;
+	}
+
+	ViewBase* AddView(ViewBase* view);
+};
+
+struct EntityCommand
+{
+	enum class Type { create, modify, destroy };
+
+	Type type;
+
+	// The system that recorded this and the order it was recorded in; playback sorts by these,
+	// so it doesn't matter which threads the systems happened to run on.
+	int system;
+	int sequence;
+
+	// Created entities use the scene and name; everything else goes by the target.
+	int scene;
+	std::string name;
+	EntityHandle target;
+
+	// If this creates an instance of a prefab, playback uses this to make room for all of them at once.
+	Prefab* prefab = nullptr;
+
+	std::function<void(Entity*)> apply;
+};
+
+class EntityCommandBuffer
+{
+public:
+	vector<EntityCommand> commands;
+
+	// The build function gets the new entity once it exists, and is where its components should be added.
+	void CreateEntity(int scene, std::string name, std::function<void(Entity*)> build)
+	{
+		EntityCommand c = Record(EntityCommand::Type::create, EntityHandle());
+		c.scene = scene;
+		c.name = name;
+		c.apply = build;
+		commands.push_back(c);
+	}
+
+	// Creates one copy of a prefab (see prefab.h).
+	void Instantiate(Prefab* prefab, const PrefabInstance& instance);
+
+	// The arguments are copied now, so anything that might change before playback should be passed by value.
+	template <typename T, typename... Args>
+	void AddComponent(Entity* entity, Args... args)
+	{
+		EntityCommand c = Record(EntityCommand::Type::modify, entity->Get_Handle());
+		c.apply = [args...](Entity* e) { ECS::main.AddComponent<T>(e, args...); };
+		commands.push_back(c);
+	}
+
+	template <typename T>
+	void RemoveComponent(Entity* entity)
+	{
+		EntityCommand c = Record(EntityCommand::Type::modify, entity->Get_Handle());
+		c.apply = [](Entity* e) { ECS::main.RemoveComponent(e, ComponentId<T>()); };
+		commands.push_back(c);
+	}
+
+	void DestroyEntity(Entity* entity)
+	{
+		commands.push_back(Record(EntityCommand::Type::destroy, entity->Get_Handle()));
+	}
+
+private:
+	int sequence = 0;
+
+	EntityCommand Record(EntityCommand::Type type, EntityHandle target)
+	{
+		EntityCommand c;
+		c.type = type;
+		c.system = Scheduler::running;
+		c.sequence = sequence++;
+		c.scene = 0;
+		c.target = target;
+		return c;
+	}
+
+	friend class ECS;
 };
 
 #endif
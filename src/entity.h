@@ -2,7 +2,8 @@
 #define ENTITY_H
 
 #include <vector>
-#include <unordered_map>
+#include <string>
+#include <cstdint>
 
 // Entities are the basic objects in the game.
 // While it would be perhaps faster to implement a
@@ -16,29 +17,89 @@
 // information accessed in a contiguous fashion.
 
 class Component;
+class Prefab;
+
+// Every component type has a constant ID (see component.h); this is how we get from one to the other.
+template <typename T> constexpr int ComponentId();
+
+// The number of component IDs an entity has room for; it matches the number of bits in the component mask.
+static const int maxComponentIDs = 32;
+
+// Entities shouldn't hold onto pointers to other entities (or their components), since
+// the other entity might die and its memory might be handed to something else entirely.
+// Instead, they hold handles: the lower bits are the entity's slot in the ECS hub's slot table
+// and the upper bits are the generation of that slot, which goes up every time an entity in it dies.
+// If the generations don't match, the entity you were pointing at is gone, and the hub will tell you so
+// (by returning nullptr from GetEntity) rather than handing you whatever's living there now.
+struct EntityHandle
+{
+    static const uint32_t indexBits = 20;
+    static const uint32_t indexMask = (1u << indexBits) - 1;
+
+    // Zero is never a valid handle (generations start at one), so it doubles as "no entity."
+    uint32_t value = 0;
+
+    uint32_t Index() const { return value & indexMask; }
+    uint32_t Generation() const { return value >> indexBits; }
+
+    bool operator==(const EntityHandle& other) const { return value == other.value; }
+    bool operator!=(const EntityHandle& other) const { return value != other.value; }
+
+    EntityHandle() { }
+    EntityHandle(uint32_t index, uint32_t generation) { value = (generation << indexBits) | (index & indexMask); }
+};
 
 class Entity
 {
 private:
     // Basic Info
-    int ID;
+    // The ID is just the value of the entity's handle.
+    uint32_t ID;
     int scene;
-    std::string name;
+
+    // This is the name's number in the registry's string table (see registry.h).
+    int nameID;
+
+    // Components are filed under their entity's scene (see componentpool.h and view.h) when they're added,
+    // so moving an entity that already has some would leave them in the old scene's lists;
+    // only the ECS hub sets the scene, when it hands out a slot in CreateEntity().
+    friend class ECS;
+    void        Set_Scene(int newScene);
 
 public:
     // Components
-    std::unordered_map<int, Component*> componentIDMap;
+    // This is indexed by component ID; anything the entity doesn't have is nullptr.
+    Component* componentsByID[maxComponentIDs] = { };
     std::vector<Component*> components;
 
-    int         Get_ID();
-    int         Get_Scene();
-    std::string Get_Name();
+    // One bit for each component ID the entity has; this is how we know which systems to bother when it dies.
+    uint32_t componentMask = 0;
 
-    void        Set_ID(int newID);
-    void        Set_Scene(int newScene);
-    void        Set_Name(std::string newName);
+    // The prefab this entity was made from, if it's one that gets recycled (see prefab.h).
+    // Parked entities are dead ones sitting on their prefab's free list, waiting to be spawned again.
+    Prefab* prefab = nullptr;
+    bool parked = false;
+
+    // One bit for each of the registry's tags the entity has.
+    uint32_t tagMask = 0;
+
+    // These are how one should usually get at an entity's components, e.g. entity->Get<PhysicsComponent>().
+    template <typename T>
+    T* Get() { return static_cast<T*>(componentsByID[ComponentId<T>()]); }
+
+    template <typename T>
+    bool Has() { return (componentMask >> ComponentId<T>()) & 1; }
+
+    uint32_t     Get_ID();
+    EntityHandle Get_Handle();
+    int          Get_Scene();
+    const std::string& Get_Name();
+    int          Get_NameID();
+
+    void        Set_ID(uint32_t newID);
+    void        Set_Name(const std::string& newName);
 
-    Entity(int ID, int scene, std::string name);
+    Entity(uint32_t ID, int scene, const std::string& name);
 };
 
 
@@ -1,7 +1,7 @@
 #include "game.h"
 #include <glm/gtc/matrix_transform.hpp>
 
-// This just holds updateOrth().
+// This just holds UpdateOrtho() and UpdateView().
 // Nothing particularly fancy.
 
 void Game::UpdateOrtho()
@@ -11,4 +11,22 @@ void Game::UpdateOrtho()
     this->projection = glm::ortho(-halfWidth * this->zoom, halfWidth * this->zoom,
         -halfHeight * this->zoom, halfHeight * this->zoom,
         0.1f, 1500.0f);
-}
\ No newline at end of file
+}
+
+// This points the camera where it should be and works out which part of the world is on screen.
+void Game::UpdateView()
+{
+    // Here, we make sure the camera is oriented correctly.
+    glm::vec3 cam = glm::vec3(camX, camY, camZ);
+    glm::vec3 center = cam + glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+    this->view = glm::lookAt(cam, center, up);
+
+    // Here we manage the game window and view.
+    const float halfWindowHeight = windowHeight * zoom * 0.5f;
+    const float halfWindowWidth = windowWidth * zoom * 0.5f;
+    this->topY = camY + halfWindowHeight;
+    this->bottomY = camY - halfWindowHeight;
+    this->rightX = camX + halfWindowWidth;
+    this->leftX = camX - halfWindowWidth;
+}
@@ -3,6 +3,7 @@
 
 #include "renderer.h"
 #include "textrenderer.h"
+#include "input.h"
 
 #include <glm/glm.hpp>
 #include <vector>
@@ -47,9 +48,13 @@ public:
 	glm::mat4 projection;
 
 	Renderer* renderer;
-	TextRenderer* textRenderer;
+	TextRenderer* textRenderer = nullptr;
+
+	// Where the systems get keys, mouse buttons and the gamepad from (see input.h).
+	InputSource* input = nullptr;
 
 	void UpdateOrtho();
+	void UpdateView();
 
 	// Keyboard and Mouse Mappings
 	int clickKey = GLFW_MOUSE_BUTTON_1;
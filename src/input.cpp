@@ -0,0 +1,41 @@
+#include "input.h"
+
+bool WindowInput::Held(int key)
+{
+	// GLFW keeps keys and mouse buttons apart, but the mouse buttons' codes are all below the first key's,
+	// so there's no need to ask about both (and have GLFW complain about whichever one it isn't).
+	if (key <= GLFW_MOUSE_BUTTON_LAST)
+	{
+		return glfwGetMouseButton(window, key) == GLFW_PRESS;
+	}
+
+	return glfwGetKey(window, key) == GLFW_PRESS;
+}
+
+bool WindowInput::Gamepad(GLFWgamepadstate& state)
+{
+	if (!glfwJoystickIsGamepad(GLFW_JOYSTICK_1))
+	{
+		return false;
+	}
+
+	glfwGetGamepadState(GLFW_JOYSTICK_1, &state);
+	return true;
+}
+
+void ScriptedInput::SetGamepad(const GLFWgamepadstate& state)
+{
+	gamepad = state;
+	hasGamepad = true;
+}
+
+bool ScriptedInput::Gamepad(GLFWgamepadstate& state)
+{
+	if (!hasGamepad)
+	{
+		return false;
+	}
+
+	state = gamepad;
+	return true;
+}
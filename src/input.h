@@ -0,0 +1,56 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+// The systems don't ask GLFW what's being pressed directly; they ask Game::main.input.
+// Normally that's a WindowInput, which just passes the question on to GLFW,
+// but a headless run (see main.cpp) has no window to ask, so it gets a ScriptedInput instead,
+// which says whatever it's been told to: nothing by default, or whatever a test or a benchmark presses and releases.
+
+#include <set>
+#include <GLFW/glfw3.h>
+
+class InputSource
+{
+public:
+	virtual ~InputSource() { }
+
+	// Whether the given key or mouse button is held down (the mappings in game.h can be either).
+	virtual bool Held(int key) = 0;
+
+	// Fills in the state of the first gamepad, or returns false if there isn't one.
+	virtual bool Gamepad(GLFWgamepadstate& state) = 0;
+};
+
+class WindowInput : public InputSource
+{
+public:
+	WindowInput(GLFWwindow* window) : window(window) { }
+
+	bool Held(int key) override;
+	bool Gamepad(GLFWgamepadstate& state) override;
+
+private:
+	GLFWwindow* window;
+};
+
+class ScriptedInput : public InputSource
+{
+public:
+	void Press(int key) { held.insert(key); }
+	void Release(int key) { held.erase(key); }
+
+	// Plugs in a gamepad that's in the given state (until UnplugGamepad() is called).
+	void SetGamepad(const GLFWgamepadstate& state);
+	void UnplugGamepad() { hasGamepad = false; }
+
+	bool Held(int key) override { return held.count(key) != 0; }
+	bool Gamepad(GLFWgamepadstate& state) override;
+
+private:
+	std::set<int> held;
+
+	bool hasGamepad = false;
+	GLFWgamepadstate gamepad;
+};
+
+#endif
@@ -2,6 +2,8 @@
 //
 
 #include <iostream>
+#include <string>
+#include <chrono>
 #include <filesystem>
 #include <map>
 #include <stack>
@@ -18,10 +20,15 @@
 #include "entity.h"
 #include "particleengine.h"
 #include "ecs.h"
+#include "input.h"
+#include "profiler.h"
+#include "overlay.h"
 
 Game Game::main;
 ECS ECS::main;
 ParticleEngine ParticleEngine::main;
+BodyStream BodyStream::main;
+Profiler Profiler::main;
 
 // This is the hub which handles updates and setup.
 // In an attempt to keep this from getting cluttered, we're keeping some information
@@ -52,58 +59,108 @@ void MessageCallback(GLenum source,
     std::cout << "\n";
 }
 
-int main(void)
+int main(int argc, char* argv[])
 {
+    #pragma region Arguments
+    // Running with --headless [steps] skips the window and GL altogether: input comes from a ScriptedInput,
+    // the renderer just batches quads up and throws them away, and the simulation is stepped as fast as it'll go
+    // for however many fixed steps were asked for. That's for soak tests and benchmarks on machines with no GPU (or no display).
+    // --profile turns the profiler on from the start (see profiler.h) and writes its trace when the game closes.
+    // --seed [seed] seeds rand() with the given number instead of the time, so a headless run can be repeated exactly.
+    bool headless = false;
+    int headlessSteps = 10000;
+    bool profile = false;
+    unsigned int seed = time(NULL);
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--headless")
+        {
+            headless = true;
+
+            if (i + 1 < argc && isdigit(argv[i + 1][0]))
+            {
+                headlessSteps = atoi(argv[++i]);
+            }
+        }
+        else if (std::string(argv[i]) == "--profile")
+        {
+            profile = true;
+        }
+        else if (std::string(argv[i]) == "--seed" && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], nullptr, 10);
+        }
+    }
+
+    Profiler::main.enabled = profile;
+
+    Texture2D::headless = headless;
+    #pragma endregion
+
     #pragma region GL Rendering Setup
     int windowWidth = Game::main.windowWidth;
     int windowHeight = Game::main.windowHeight;
 
     // Here we're initiating all the stuff related to rendering.
-    GLFWwindow* window;
+    GLFWwindow* window = nullptr;
+    ScriptedInput* script = nullptr;
 
-    if (!glfwInit())
-        return -1;
+    if (headless)
+    {
+        script = new ScriptedInput();
+        Game::main.input = script;
+    }
+    else
+    {
+        if (!glfwInit())
+            return -1;
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    glfwWindowHintString(GLFW_X11_CLASS_NAME, "OpenGL");
-    glfwWindowHintString(GLFW_X11_INSTANCE_NAME, "OpenGL");
+        glfwWindowHintString(GLFW_X11_CLASS_NAME, "OpenGL");
+        glfwWindowHintString(GLFW_X11_INSTANCE_NAME, "OpenGL");
 
-    window = glfwCreateWindow(windowWidth, windowHeight, "The Moonlight Blade", NULL, NULL);
-    if (!window)
-    {
-        glfwTerminate();
-        return -1;
-    }
+        window = glfwCreateWindow(windowWidth, windowHeight, "The Moonlight Blade", NULL, NULL);
+        if (!window)
+        {
+            glfwTerminate();
+            return -1;
+        }
 
-    glfwMakeContextCurrent(window);
+        glfwMakeContextCurrent(window);
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << '\n';
-        return -1;
-    }
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << '\n';
+            return -1;
+        }
+
+        glfwSetWindowPosCallback(window, WindowPosCallback);
 
-    glfwSetWindowPosCallback(window, WindowPosCallback);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        /*glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+        glEnable(GL_DEBUG_OUTPUT);
+        glDebugMessageCallback(MessageCallback, 0);*/
 
-    /*glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-    glEnable(GL_DEBUG_OUTPUT);
-    glDebugMessageCallback(MessageCallback, 0);*/
+        Game::main.window = window;
+        Game::main.input = new WindowInput(window);
 
-    Game::main.window = window;
-    
-    printf("OpenGL version supported by this platform (%s): \n", glGetString(GL_VERSION));
+        printf("OpenGL version supported by this platform (%s): \n", glGetString(GL_VERSION));
+    }
     #pragma endregion
 
     #pragma region World Setup
 
-    srand(time(NULL));
+    srand(seed);
     ECS::main.Init();
+
+    // The simulation runs at 120 steps a second no matter how fast we're drawing (and catches up at most five steps in a frame).
+    ECS::main.SetSimulationRate(120.0f, 5);
     ParticleEngine::main.Init(0.05f);
 
     #pragma endregion
@@ -115,7 +172,8 @@ int main(void)
 
     Texture2D* whiteTexture = Texture2D::whiteTexture();
 
-    Renderer renderer{ whiteTexture->ID };
+    // A headless renderer has no GL behind it (see renderer.h), but it's filled in just the same.
+    Renderer& renderer = *(headless ? new Renderer() : new Renderer(whiteTexture->ID));
 
     // I should talk about textures. Every texture has a source and a map.
     // The source textures are the same across all the sprites and animations for an object or character,
@@ -236,11 +294,59 @@ int main(void)
 
 #   pragma region Text Rendering Setup
 
-    TextRenderer textRenderer("assets/fonts/Cantarell-Bold.otf", 64);
-    Game::main.textRenderer = &textRenderer;
+    // Text is rendered straight to textures through GL, so there's none of it in a headless run.
+    TextRenderer* textRenderer = nullptr;
+
+    if (!headless)
+    {
+        textRenderer = new TextRenderer("assets/fonts/Cantarell-Bold.otf", 64);
+    }
+
+    Game::main.textRenderer = textRenderer;
 
     #pragma endregion
 
+    #pragma region Headless Loop
+    if (headless)
+    {
+        // Every update is exactly one fixed step, so a run always does the same thing (given the same --seed),
+        // no matter how fast the machine is.
+        auto begin = std::chrono::steady_clock::now();
+        long long quads = 0;
+
+        for (int step = 0; step < headlessSteps; step++)
+        {
+            ProfileScope frame("frame");
+
+            Game::main.UpdateView();
+
+            ECS::main.Update(ECS::main.fixedStep);
+            ParticleEngine::main.Update(ECS::main.fixedStep);
+
+            quads += renderer.QuadCount();
+            renderer.resetBuffers();
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        std::cout << "Headless: " + std::to_string(headlessSteps) + " steps in " + std::to_string(seconds) + "s ("
+            + std::to_string(headlessSteps / seconds) + " steps/s, " + std::to_string(quads) + " quads, "
+            + std::to_string(ECS::main.registry.entities.size()) + " live entities, seed " + std::to_string(seed) + ")\n";
+
+        if (profile)
+        {
+            Profiler::main.WriteSummary(std::cout);
+            Profiler::main.WriteTrace("trace.json");
+        }
+
+        delete script;
+        delete &renderer;
+        delete whiteTexture;
+
+        return 0;
+    }
+    #pragma endregion
+
     #pragma region Game Loop
     // This is the loop where the game runs, duh.
     // Everything that should happen each frame should occur here,
@@ -257,6 +363,11 @@ int main(void)
     bool slowTime = false;
     float slowLastChange = glfwGetTime();
 
+    float profileLastChange = glfwGetTime();
+
+    PerformanceOverlay overlay;
+    float overlayLastChange = glfwGetTime();
+
     bool limitFPS = false;
     int fps = 60;
     const int ms = (int)(1000 * (1.0f / (fps * 2.0f)));
@@ -264,12 +375,16 @@ int main(void)
 
     while (!glfwWindowShouldClose(window))
     {
+        ProfileScope frame("frame");
+
         #pragma region Elapsed Time
 
         float deltaTime = glfwGetTime() - checkedTime;
         // std::cout << "Delta Time: " + std::to_string(deltaTime) + "\n";
         checkedTime = glfwGetTime();
 
+        overlay.Update(deltaTime);
+
         #pragma endregion
 
         #pragma region FPS
@@ -317,19 +432,7 @@ int main(void)
             }
         }
 
-        // Here, we make sure the camera is oriented correctly.
-        glm::vec3 cam = glm::vec3(Game::main.camX, Game::main.camY, Game::main.camZ);
-        glm::vec3 center = cam + glm::vec3(0.0f, 0.0f, -1.0f);
-        glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-        Game::main.view = glm::lookAt(cam, center, up);
-
-        // Here we manage the game window and view.
-        const float halfWindowHeight = Game::main.windowHeight * Game::main.zoom * 0.5f;
-        const float halfWindowWidth = Game::main.windowWidth * Game::main.zoom * 0.5f;
-        Game::main.topY = Game::main.camY + halfWindowHeight;
-        Game::main.bottomY = Game::main.camY - halfWindowHeight;
-        Game::main.rightX = Game::main.camX + halfWindowWidth;
-        Game::main.leftX = Game::main.camX - halfWindowWidth;
+        Game::main.UpdateView();
         #pragma endregion
 
         #pragma region Input
@@ -353,6 +456,30 @@ int main(void)
             glfwSetWindowShouldClose(window, true);
         }
 
+        if (glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS && glfwGetTime() > overlayLastChange + 0.5f)
+        {
+            overlayLastChange = glfwGetTime();
+            overlay.visible = !overlay.visible;
+        }
+
+        // F9 starts the profiler, and pressing it again stops it and writes out what it recorded.
+        if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS && glfwGetTime() > profileLastChange + 0.5f)
+        {
+            profileLastChange = glfwGetTime();
+
+            if (!Profiler::main.enabled)
+            {
+                Profiler::main.Clear();
+                Profiler::main.enabled = true;
+            }
+            else
+            {
+                Profiler::main.enabled = false;
+                Profiler::main.WriteSummary(std::cout);
+                Profiler::main.WriteTrace("trace.json");
+            }
+        }
+
         if (glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS)
         {
             if (Game::main.zoom - 5.0f * deltaTime > 0.1f)
@@ -412,6 +539,8 @@ int main(void)
 
         #pragma region Render
         // This is where we finally render and reset buffers.
+        overlay.Draw();
+
         Game::main.renderer->sendToGL();
         Game::main.renderer->resetBuffers();
 
@@ -419,16 +548,33 @@ int main(void)
         {
             std::this_thread::sleep_until(end);
         }
-        glfwSwapBuffers(window);
+        {
+            ProfileScope scope("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
 
         windowMoved = 0;
-        glfwPollEvents();
+
+        {
+            ProfileScope scope("glfwPollEvents");
+            glfwPollEvents();
+        }
         glCheckError();
         #pragma endregion
     }
     #pragma endregion
 
     #pragma region Shutdown
+    if (Profiler::main.enabled)
+    {
+        Profiler::main.enabled = false;
+        Profiler::main.WriteSummary(std::cout);
+        Profiler::main.WriteTrace("trace.json");
+    }
+
+    delete Game::main.input;
+    delete textRenderer;
+    delete &renderer;
     delete whiteTexture;
 
     glfwTerminate();
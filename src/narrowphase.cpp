@@ -0,0 +1,318 @@
+// This holds the narrowphase's ray-versus-rectangle test and its batched versions (see narrowphase.h).
+
+#include "narrowphase.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SWEPT_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SWEPT_SSE
+#endif
+
+bool RayOverlapRect(glm::vec2 rayOrigin, glm::vec2 rayDir, glm::vec2 rectCenter, float rWidth, float rHeight,
+					glm::vec2& contactPoint, glm::vec2& contactNormal, float& tHitNear)
+{
+	glm::vec2 invertDir = 1.0f / rayDir;
+
+	glm::vec2 rBL = glm::vec2(rectCenter.x - (rWidth / 2.0f), rectCenter.y - (rHeight / 2.0f));
+	glm::vec2 rTR = glm::vec2(rectCenter.x + (rWidth / 2.0f), rectCenter.y + (rHeight / 2.0f));
+
+	glm::vec2 tNear = (rBL - rayOrigin) * invertDir;
+	glm::vec2 tFar = (rTR - rayOrigin) * invertDir;
+
+	if (std::isnan(tFar.y) || std::isnan(tFar.x))
+	{
+		return false;
+	}
+	if (std::isnan(tNear.y) || std::isnan(tNear.x))
+	{
+		return false;
+	}
+
+	if (tNear.x > tFar.x)
+	{
+		std::swap(tNear.x, tFar.x);
+	}
+	if (tNear.y > tFar.y)
+	{
+		std::swap(tNear.y, tFar.y);
+	}
+
+	if (tNear.x > tFar.y || tNear.y > tFar.x)
+	{
+		return false;
+	}
+
+	tHitNear = std::max(tNear.x, tNear.y);
+	float tHitFar = std::min(tFar.x, tFar.y);
+
+	if (tHitFar < 0)
+	{
+		return false;
+	}
+
+	contactPoint = rayOrigin + tHitNear * rayDir;
+
+	if (tNear.x > tNear.y)
+	{
+		if (invertDir.x < 0)
+		{
+			contactNormal = glm::vec2(1, 0);
+		}
+		else
+		{
+			contactNormal = glm::vec2(-1, 0);
+		}
+	}
+	else
+	{
+		if (invertDir.y < 0)
+		{
+			contactNormal = glm::vec2(0, 1);
+		}
+		else
+		{
+			contactNormal = glm::vec2(0, -1);
+		}
+	}
+
+	/*Texture2D* t = Game::main.textureMap["blank"];
+	Game::main.renderer->prepareQuad(contactPoint, t->width, t->height, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f), t->ID);
+	Game::main.renderer->prepareQuad(contactPoint + contactNormal, t->width / 2.0f, t->height * 2.0f, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), t->ID);
+	Game::main.renderer->prepareQuad(rayOrigin + rayDir, t->width / 2.0f, t->height / 2.0f, glm::vec4(0.0f, 1.0f, 1.0f, 1.0f), t->ID);*/
+
+	return true;
+}
+
+void SweptPairs::Clear()
+{
+	originX.clear();
+	originY.clear();
+	dirX.clear();
+	dirY.clear();
+	centerX.clear();
+	centerY.clear();
+	width.clear();
+	height.clear();
+}
+
+void SweptPairs::Add(glm::vec2 origin, glm::vec2 dir, glm::vec2 center, float width, float height)
+{
+	originX.push_back(origin.x);
+	originY.push_back(origin.y);
+	dirX.push_back(dir.x);
+	dirY.push_back(dir.y);
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	this->width.push_back(width);
+	this->height.push_back(height);
+}
+
+void SweptAABBScalar(SweptPairs& pairs, int begin, int end)
+{
+	for (int i = begin; i < end; i++)
+	{
+		glm::vec2 contactPoint = glm::vec2(0, 0);
+		glm::vec2 contactNormal = glm::vec2(0, 0);
+		float time = 0.0f;
+
+		bool hit = RayOverlapRect(glm::vec2(pairs.originX[i], pairs.originY[i]), glm::vec2(pairs.dirX[i], pairs.dirY[i]),
+			glm::vec2(pairs.centerX[i], pairs.centerY[i]), pairs.width[i], pairs.height[i], contactPoint, contactNormal, time);
+
+		pairs.hit[i] = hit && time < 1.0f && time >= 0.0f;
+		pairs.time[i] = time;
+		pairs.contactX[i] = contactPoint.x;
+		pairs.contactY[i] = contactPoint.y;
+		pairs.normalX[i] = contactNormal.x;
+		pairs.normalY[i] = contactNormal.y;
+	}
+}
+
+// The wide versions follow RayOverlapRect() step for step, just without the branches: every pair does every step,
+// and the ones that would've returned early are masked off at the end.
+// The mins and maxes take their arguments in the order that makes them pick the same side std::min() and std::max() (and the swaps) do on ties.
+
+#ifdef SWEPT_AVX
+
+// Picks a where mask is set and b where it's not. This isn't _mm256_blendv_ps(), because GCC turns that into a branch per lane
+// when a and b are constants, which made the whole thing slower than SSE.
+static __m256 Select(__m256 mask, __m256 a, __m256 b)
+{
+	return _mm256_or_ps(_mm256_and_ps(mask, a), _mm256_andnot_ps(mask, b));
+}
+
+static int SweptAABBWide(SweptPairs& p, int count)
+{
+	const int width = 8;
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 minusOne = _mm256_set1_ps(-1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+
+	int i = 0;
+
+	for (; i + width <= count; i += width)
+	{
+		__m256 ox = _mm256_loadu_ps(&p.originX[i]);
+		__m256 oy = _mm256_loadu_ps(&p.originY[i]);
+		__m256 dx = _mm256_loadu_ps(&p.dirX[i]);
+		__m256 dy = _mm256_loadu_ps(&p.dirY[i]);
+		__m256 cx = _mm256_loadu_ps(&p.centerX[i]);
+		__m256 cy = _mm256_loadu_ps(&p.centerY[i]);
+		__m256 halfWidth = _mm256_div_ps(_mm256_loadu_ps(&p.width[i]), two);
+		__m256 halfHeight = _mm256_div_ps(_mm256_loadu_ps(&p.height[i]), two);
+
+		__m256 invX = _mm256_div_ps(one, dx);
+		__m256 invY = _mm256_div_ps(one, dy);
+
+		__m256 nearX = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(cx, halfWidth), ox), invX);
+		__m256 nearY = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(cy, halfHeight), oy), invY);
+		__m256 farX = _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(cx, halfWidth), ox), invX);
+		__m256 farY = _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(cy, halfHeight), oy), invY);
+
+		__m256 valid = _mm256_and_ps(_mm256_cmp_ps(nearX, farX, _CMP_ORD_Q), _mm256_cmp_ps(nearY, farY, _CMP_ORD_Q));
+
+		__m256 nX = _mm256_min_ps(farX, nearX);
+		__m256 fX = _mm256_max_ps(nearX, farX);
+		__m256 nY = _mm256_min_ps(farY, nearY);
+		__m256 fY = _mm256_max_ps(nearY, farY);
+
+		valid = _mm256_andnot_ps(_mm256_or_ps(_mm256_cmp_ps(nX, fY, _CMP_GT_OQ), _mm256_cmp_ps(nY, fX, _CMP_GT_OQ)), valid);
+
+		__m256 tNear = _mm256_max_ps(nY, nX);
+		__m256 tFar = _mm256_min_ps(fY, fX);
+
+		valid = _mm256_andnot_ps(_mm256_cmp_ps(tFar, zero, _CMP_LT_OQ), valid);
+		valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(tNear, one, _CMP_LT_OQ), _mm256_cmp_ps(tNear, zero, _CMP_GE_OQ)));
+
+		__m256 xSide = _mm256_cmp_ps(nX, nY, _CMP_GT_OQ);
+		__m256 normalX = Select(_mm256_cmp_ps(invX, zero, _CMP_LT_OQ), one, minusOne);
+		__m256 normalY = Select(_mm256_cmp_ps(invY, zero, _CMP_LT_OQ), one, minusOne);
+
+		_mm256_storeu_ps(&p.time[i], tNear);
+		_mm256_storeu_ps(&p.contactX[i], _mm256_add_ps(ox, _mm256_mul_ps(tNear, dx)));
+		_mm256_storeu_ps(&p.contactY[i], _mm256_add_ps(oy, _mm256_mul_ps(tNear, dy)));
+		_mm256_storeu_ps(&p.normalX[i], _mm256_and_ps(xSide, normalX));
+		_mm256_storeu_ps(&p.normalY[i], _mm256_andnot_ps(xSide, normalY));
+
+		int mask = _mm256_movemask_ps(valid);
+
+		for (int lane = 0; lane < width; lane++)
+		{
+			p.hit[i + lane] = (mask >> lane) & 1;
+		}
+	}
+
+	return i;
+}
+
+#elif defined(SWEPT_SSE)
+
+static __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static int SweptAABBWide(SweptPairs& p, int count)
+{
+	const int width = 4;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minusOne = _mm_set1_ps(-1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	int i = 0;
+
+	for (; i + width <= count; i += width)
+	{
+		__m128 ox = _mm_loadu_ps(&p.originX[i]);
+		__m128 oy = _mm_loadu_ps(&p.originY[i]);
+		__m128 dx = _mm_loadu_ps(&p.dirX[i]);
+		__m128 dy = _mm_loadu_ps(&p.dirY[i]);
+		__m128 cx = _mm_loadu_ps(&p.centerX[i]);
+		__m128 cy = _mm_loadu_ps(&p.centerY[i]);
+		__m128 halfWidth = _mm_div_ps(_mm_loadu_ps(&p.width[i]), two);
+		__m128 halfHeight = _mm_div_ps(_mm_loadu_ps(&p.height[i]), two);
+
+		__m128 invX = _mm_div_ps(one, dx);
+		__m128 invY = _mm_div_ps(one, dy);
+
+		__m128 nearX = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(cx, halfWidth), ox), invX);
+		__m128 nearY = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(cy, halfHeight), oy), invY);
+		__m128 farX = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(cx, halfWidth), ox), invX);
+		__m128 farY = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(cy, halfHeight), oy), invY);
+
+		__m128 valid = _mm_and_ps(_mm_cmpord_ps(nearX, farX), _mm_cmpord_ps(nearY, farY));
+
+		__m128 nX = _mm_min_ps(farX, nearX);
+		__m128 fX = _mm_max_ps(nearX, farX);
+		__m128 nY = _mm_min_ps(farY, nearY);
+		__m128 fY = _mm_max_ps(nearY, farY);
+
+		valid = _mm_andnot_ps(_mm_or_ps(_mm_cmpgt_ps(nX, fY), _mm_cmpgt_ps(nY, fX)), valid);
+
+		__m128 tNear = _mm_max_ps(nY, nX);
+		__m128 tFar = _mm_min_ps(fY, fX);
+
+		valid = _mm_andnot_ps(_mm_cmplt_ps(tFar, zero), valid);
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmplt_ps(tNear, one), _mm_cmpge_ps(tNear, zero)));
+
+		__m128 xSide = _mm_cmpgt_ps(nX, nY);
+		__m128 normalX = Select(_mm_cmplt_ps(invX, zero), one, minusOne);
+		__m128 normalY = Select(_mm_cmplt_ps(invY, zero), one, minusOne);
+
+		_mm_storeu_ps(&p.time[i], tNear);
+		_mm_storeu_ps(&p.contactX[i], _mm_add_ps(ox, _mm_mul_ps(tNear, dx)));
+		_mm_storeu_ps(&p.contactY[i], _mm_add_ps(oy, _mm_mul_ps(tNear, dy)));
+		_mm_storeu_ps(&p.normalX[i], _mm_and_ps(xSide, normalX));
+		_mm_storeu_ps(&p.normalY[i], _mm_andnot_ps(xSide, normalY));
+
+		int mask = _mm_movemask_ps(valid);
+
+		for (int lane = 0; lane < width; lane++)
+		{
+			p.hit[i + lane] = (mask >> lane) & 1;
+		}
+	}
+
+	return i;
+}
+
+#else
+
+static int SweptAABBWide(SweptPairs& p, int count)
+{
+	return 0;
+}
+
+#endif
+
+void SweptAABB(SweptPairs& pairs)
+{
+	int count = pairs.Size();
+
+	pairs.hit.resize(count);
+	pairs.time.resize(count);
+	pairs.contactX.resize(count);
+	pairs.contactY.resize(count);
+	pairs.normalX.resize(count);
+	pairs.normalY.resize(count);
+
+	int done = SweptAABBWide(pairs, count);
+	SweptAABBScalar(pairs, done, count);
+}
+
+const char* SweptAABBKernel()
+{
+#if defined(SWEPT_AVX)
+	return "avx";
+#elif defined(SWEPT_SSE)
+	return "sse";
+#else
+	return "scalar";
+#endif
+}
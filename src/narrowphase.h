@@ -0,0 +1,57 @@
+#ifndef NARROWPHASE_H
+#define NARROWPHASE_H
+
+// The narrowphase works out exactly when (and from which side) two colliders run into each other during a step.
+// Every collider's a rectangle, so this is the usual swept AABB test: the moving box is shrunk down to a point
+// and the other box grown by the same amount, and then it's just a ray against a rectangle.
+
+// RayOverlapRect() does one pair at a time. SweptAABB() does the same test for a whole batch of pairs at once,
+// laid out as one array per field, so it can run 8 pairs at a time with AVX or 4 with SSE (whichever the compiler's allowed to use),
+// falling back to one at a time on anything else. All of them give exactly the same answers, down to the bit.
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Whether the ray from rayOrigin along rayDir (which is as long as it goes) hits the rectangle, and if so where, from which side, and when
+// (tHitNear is how far along the ray that happens; it can be negative or past one, so callers check that themselves).
+bool RayOverlapRect(glm::vec2 rayOrigin, glm::vec2 rayDir, glm::vec2 rectCenter, float rWidth, float rHeight,
+					glm::vec2& contactPoint, glm::vec2& contactNormal, float& tHitNear);
+
+struct SweptPairs
+{
+	// For each pair: the moving collider's center, how far it moves relative to the other one this step,
+	// the other one's center, and the two colliders' widths and heights added together.
+	std::vector<float> originX;
+	std::vector<float> originY;
+	std::vector<float> dirX;
+	std::vector<float> dirY;
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> width;
+	std::vector<float> height;
+
+	// What SweptAABB() works out: whether they hit during the step (that is, the ray hits at a time from zero up to but not including one),
+	// and if so, when, where and from which side. The rest are left as garbage for pairs that miss.
+	std::vector<uint8_t> hit;
+	std::vector<float> time;
+	std::vector<float> contactX;
+	std::vector<float> contactY;
+	std::vector<float> normalX;
+	std::vector<float> normalY;
+
+	int Size() const { return originX.size(); }
+
+	void Clear();
+	void Add(glm::vec2 origin, glm::vec2 dir, glm::vec2 center, float width, float height);
+};
+
+void SweptAABB(SweptPairs& pairs);
+
+// Always one pair at a time, over [begin, end); SweptAABB() uses it for whatever's left over after the last full batch.
+void SweptAABBScalar(SweptPairs& pairs, int begin, int end);
+
+// Which kernel SweptAABB() ends up using ("avx", "sse" or "scalar").
+const char* SweptAABBKernel();
+
+#endif
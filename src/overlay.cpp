@@ -0,0 +1,141 @@
+// This draws the performance overlay (see overlay.h).
+
+#include "overlay.h"
+#include "game.h"
+#include "ecs.h"
+#include "system.h"
+#include "particleengine.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// Everything on the overlay is laid out in screen pixels.
+constexpr float panelX = 10.0f;
+constexpr float panelY = 10.0f;
+constexpr float panelWidth = 300.0f;
+constexpr float lineHeight = 16.0f;
+constexpr float padding = 8.0f;
+
+// The overlay is drawn in front of everything else (the camera's at z = 120).
+constexpr float overlayZ = 110.0f;
+
+// The text renderer's font is 64 pixels tall.
+constexpr float textScale = 12.0f / 64.0f;
+
+// The graph's full height is this many milliseconds; frames over budget are drawn yellow, and frames twice over it red.
+constexpr float graphMs = 50.0f;
+constexpr float budgetMs = 1000.0f / 60.0f;
+constexpr float graphHeight = 50.0f;
+
+void PerformanceOverlay::Update(float deltaTime)
+{
+	history[next] = deltaTime * 1000.0f;
+	next = (next + 1) % historySize;
+}
+
+void PerformanceOverlay::Draw()
+{
+	if (!visible || Game::main.textRenderer == nullptr)
+	{
+		return;
+	}
+
+	const RenderStats& render = Game::main.renderer->lastFrame;
+	const glm::vec4 white = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	const glm::vec4 grey = glm::vec4(0.7f, 0.7f, 0.7f, 1.0f);
+
+	float total = 0.0f;
+	float worst = 0.0f;
+
+	for (int i = 0; i < historySize; i++)
+	{
+		total += history[i];
+		worst = std::max(worst, history[i]);
+	}
+
+	float average = total / historySize;
+
+	// The systems are listed slowest first.
+	std::vector<System*> systems;
+
+	for (int i = 0; i < ECS::main.componentBlocks.size(); i++)
+	{
+		systems.push_back(ECS::main.componentBlocks[i]->system);
+	}
+
+	std::sort(systems.begin(), systems.end(), [](System* a, System* b) { return a->lastMs > b->lastMs; });
+
+	const int headerLines = 4;
+	float panelHeight = padding * 3 + headerLines * lineHeight + graphHeight + systems.size() * lineHeight;
+
+	Rect(panelX, panelY, panelWidth, panelHeight, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+
+	char line[128];
+	float x = panelX + padding;
+	float y = panelY + padding;
+
+	snprintf(line, sizeof(line), "%.1f fps  %.2f ms avg  %.2f ms max", (average > 0.0f) ? 1000.0f / average : 0.0f, average, worst);
+	Text(line, x, y, white);
+	y += lineHeight;
+
+	snprintf(line, sizeof(line), "%d draw calls  %d batches", render.drawCalls, render.batches);
+	Text(line, x, y, white);
+	y += lineHeight;
+
+	snprintf(line, sizeof(line), "%d quads  %d texture binds", render.quads, render.texturesBound);
+	Text(line, x, y, white);
+	y += lineHeight;
+
+	snprintf(line, sizeof(line), "%d entities  %d particles", ECS::main.registry.entities.size(), (int)ParticleEngine::main.particles.size());
+	Text(line, x, y, white);
+	y += lineHeight;
+
+	#pragma region Frame Time Graph
+	// The oldest frame's on the left.
+	const float barWidth = (panelWidth - padding * 2) / historySize;
+	float graphBottom = y + graphHeight;
+
+	Rect(x, y, panelWidth - padding * 2, graphHeight, glm::vec4(0.2f, 0.2f, 0.2f, 0.6f));
+
+	for (int i = 0; i < historySize; i++)
+	{
+		float ms = history[(next + i) % historySize];
+		float height = std::min(ms / graphMs, 1.0f) * graphHeight;
+
+		glm::vec4 color = (ms > budgetMs * 2.0f) ? glm::vec4(1.0f, 0.2f, 0.2f, 1.0f) :
+			(ms > budgetMs) ? glm::vec4(1.0f, 0.9f, 0.2f, 1.0f) : glm::vec4(0.2f, 1.0f, 0.4f, 1.0f);
+
+		Rect(x + i * barWidth, graphBottom - height, barWidth, height, color);
+	}
+
+	// This line is the frame budget.
+	Rect(x, graphBottom - (budgetMs / graphMs) * graphHeight, panelWidth - padding * 2, 1.0f, white);
+
+	y = graphBottom + padding;
+	#pragma endregion
+
+	for (int i = 0; i < systems.size(); i++)
+	{
+		snprintf(line, sizeof(line), "%-22s %6.3f ms", systems[i]->name, systems[i]->lastMs);
+		Text(line, x, y, systems[i]->render ? grey : white);
+		y += lineHeight;
+	}
+}
+
+void PerformanceOverlay::Rect(float x, float y, float width, float height, glm::vec4 color)
+{
+	const float zoom = Game::main.zoom;
+	GLuint white = Game::main.renderer->whiteTextureID;
+
+	glm::vec3 center = glm::vec3(Game::main.leftX + (x + width / 2.0f) * zoom, Game::main.topY - (y + height / 2.0f) * zoom, overlayZ);
+	Game::main.renderer->prepareQuad(center, width, height, zoom, zoom, color, white, white);
+}
+
+void PerformanceOverlay::Text(const std::string& text, float x, float y, glm::vec4 color)
+{
+	const float zoom = Game::main.zoom;
+
+	// The text renderer wants the baseline, so the line's moved down by most of its height.
+	float baseline = y + lineHeight * 0.75f;
+	Game::main.textRenderer->RenderText(text, Game::main.leftX + x * zoom, Game::main.topY - baseline * zoom, textScale * zoom, textScale * zoom, color);
+}
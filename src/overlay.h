@@ -0,0 +1,36 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+// The performance overlay is a little panel in the top-left corner of the screen (toggled with F3)
+// that shows what the last frame cost: a graph of recent frame times, how long each system took,
+// how many draw calls, batches, quads and texture binds the renderer needed, and how many entities and particles there are.
+// It's drawn through the same batch renderer and text renderer as everything else, so it costs a few hundred quads when it's up
+// (which do show up in its own quad count) and nothing at all when it's not.
+
+#include <string>
+#include <glm/glm.hpp>
+
+class PerformanceOverlay
+{
+public:
+	bool visible = false;
+
+	// Records how long the last frame took; this is called every frame, whether the overlay's up or not,
+	// so the graph is already full when it's turned on.
+	void Update(float deltaTime);
+
+	// Prepares the overlay's quads; this has to happen after everything else is prepared (so it's drawn on top) and before sendToGL().
+	void Draw();
+
+private:
+	static constexpr int historySize = 120;
+
+	float history[historySize] = {};
+	int next = 0;
+
+	// These take positions in screen pixels from the top-left corner of the window.
+	void Rect(float x, float y, float width, float height, glm::vec4 color);
+	void Text(const std::string& text, float x, float y, glm::vec4 color);
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include <vector>
 #include "game.h"
 #include "texture_2D.h"
+#include "profiler.h"
 
 // Seeing as particles won't interact much with the other parts of the game, I went ahead and moved much of their logic
 // out of ecs.cpp. I didn't want it getting overly cluttered, not to mention that the particle system doesn't exactly
@@ -72,6 +73,8 @@ public:
 
 	void Update(float deltaTime)
 	{
+		ProfileScope scope("particle engine");
+
 		if (lastTick > tickDelay)
 		{
 			lastTick = 0.0f;
@@ -0,0 +1,122 @@
+// This holds the prefab logic (and the command buffer's hook for spawning prefabs).
+// The prefabs themselves are defined over in ecs.cpp, in ECS::DefinePrefabs().
+
+#include "prefab.h"
+#include "system.h"
+#include "component.h"
+#include <algorithm>
+
+Prefab::Prefab(std::string name, int scene)
+{
+	this->name = name;
+	this->scene = scene;
+}
+
+Prefab& Prefab::Recycle()
+{
+	recycles = true;
+	return *this;
+}
+
+void Prefab::Prewarm(int count)
+{
+	Reserve(count);
+
+	for (int i = 0; i < count; i++)
+	{
+		Entity* e = ECS::main.CreateEntity(scene, name);
+		e->prefab = this;
+		Build(e, PrefabInstance());
+
+		ECS::main.ParkEntity(e);
+		parked.push_back(e);
+	}
+}
+
+void Prefab::Reserve(int count)
+{
+	// Parked entities already have their components.
+	if (recycles)
+	{
+		count -= parked.size();
+	}
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < reserves.size(); i++)
+	{
+		reserves[i](count);
+	}
+}
+
+Entity* Prefab::Acquire()
+{
+	if (!recycles)
+	{
+		return ECS::main.CreateEntity(scene, name);
+	}
+
+	Entity* e;
+
+	if (parked.size() > 0)
+	{
+		e = parked.back();
+		parked.pop_back();
+		ECS::main.ReviveEntity(e);
+		stats.hits++;
+	}
+	else
+	{
+		e = ECS::main.CreateEntity(scene, name);
+		e->prefab = this;
+		stats.misses++;
+	}
+
+	stats.live++;
+	stats.highWater = std::max(stats.highWater, stats.live);
+	return e;
+}
+
+void Prefab::Build(Entity* e, const PrefabInstance& instance)
+{
+	// If the entity was parked, AddComponent() rebuilds the components it already has rather than making new ones.
+	for (int i = 0; i < components.size(); i++)
+	{
+		components[i](e, instance);
+	}
+
+	if (e->parked)
+	{
+		ECS::main.UnparkEntity(e);
+	}
+}
+
+void Prefab::Park(Entity* e)
+{
+	ECS::main.ParkEntity(e);
+	parked.push_back(e);
+	stats.live--;
+}
+
+void Prefab::Instantiate(int count, const PrefabInstance* instances)
+{
+	Reserve(count);
+
+	for (int i = 0; i < count; i++)
+	{
+		Build(Acquire(), instances[i]);
+	}
+}
+
+void EntityCommandBuffer::Instantiate(Prefab* prefab, const PrefabInstance& instance)
+{
+	EntityCommand c = Record(EntityCommand::Type::create, EntityHandle());
+	c.scene = prefab->scene;
+	c.name = prefab->name;
+	c.prefab = prefab;
+	c.apply = [prefab, instance](Entity* e) { prefab->Build(e, instance); };
+	commands.push_back(c);
+}
@@ -0,0 +1,104 @@
+#ifndef PREFAB_H
+#define PREFAB_H
+
+// A prefab is a template for a kind of entity we make a lot of, like bullets or floor tiles.
+// Rather than writing out every AddComponent() call (and all their arguments) wherever we spawn one,
+// we describe the entity once---which components it has and what they start out with---and then
+// call Instantiate() with however many we want and where they should go.
+// Since a prefab knows exactly which components it's about to make, it can make room for all of them
+// in their pools before it starts, so spawning a few hundred at once only touches the allocator once per component type (if at all).
+
+// Prefabs are defined in ECS::DefinePrefabs() and looked up by name with ECS::main.GetPrefab().
+
+// Prefabs for things that come and go constantly (like bullets) can also recycle their entities.
+// When one of those dies, rather than being torn down, it's parked: its components are switched off
+// (but left where they are, in their pools and their systems' lists) and it goes on the prefab's free list.
+// The next time the prefab is instantiated, it takes an entity off that list and rebuilds its components in place.
+// The stats say how often that worked and how many were alive at once, so that each level can prewarm about as many as it needs.
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <glm/glm.hpp>
+#include "ecs.h"
+
+// The things that change from one copy of a prefab to the next.
+struct PrefabInstance
+{
+	glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
+	float rotation = 0.0f;
+	glm::vec2 velocity = glm::vec2(0.0f, 0.0f);
+
+	// For prefabs that come in different sizes (like platforms); the others just ignore it.
+	glm::vec2 size = glm::vec2(0.0f, 0.0f);
+
+	// Whoever's responsible for this one (e.g. whoever fired a bullet).
+	EntityHandle owner;
+};
+
+struct PrefabStats
+{
+	// Spawns that got a parked entity and spawns that had to make a new one.
+	int hits = 0;
+	int misses = 0;
+
+	// How many are alive right now, and the most that have ever been alive at once.
+	int live = 0;
+	int highWater = 0;
+};
+
+class Prefab
+{
+public:
+	std::string name;
+	int scene;
+
+	// The bits of the component IDs the prefab adds.
+	uint32_t mask = 0;
+
+	bool recycles = false;
+	PrefabStats stats;
+
+	// Adds a component to the template. The function is handed the new entity and its instance,
+	// and should add the component with ECS::main.AddComponent<T>().
+	template <typename T>
+	Prefab& With(std::function<void(Entity*, const PrefabInstance&)> add)
+	{
+		mask |= (1u << ComponentId<T>());
+		components.push_back(add);
+		reserves.push_back([](int count) { ECS::Pool<T>().Reserve(count); });
+		return *this;
+	}
+
+	// Turns on recycling for this prefab's entities.
+	Prefab& Recycle();
+
+	// Makes count entities and parks them straight away, so the first spawns don't have to make anything.
+	void Prewarm(int count);
+
+	// Makes room in the component pools for count more instances.
+	void Reserve(int count);
+
+	// Returns an entity to build an instance on: a parked one if there are any, otherwise a brand-new one.
+	Entity* Acquire();
+
+	// Adds the prefab's components to an entity from Acquire().
+	void Build(Entity* e, const PrefabInstance& instance);
+
+	// Called by ECS::DeleteEntity() instead of tearing the entity down.
+	void Park(Entity* e);
+
+	// Creates count new entities, one for each of the given instances.
+	void Instantiate(int count, const PrefabInstance* instances);
+
+	Prefab(std::string name, int scene);
+
+private:
+	std::vector<std::function<void(Entity*, const PrefabInstance&)>> components;
+	std::vector<std::function<void(int)>> reserves;
+
+	// The parked entities, waiting to be used again.
+	std::vector<Entity*> parked;
+};
+
+#endif
@@ -0,0 +1,123 @@
+// This holds the profiler's bookkeeping and its exporters (see profiler.h).
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+Profiler::~Profiler()
+{
+	for (int i = 0; i < threads.size(); i++)
+	{
+		delete threads[i];
+	}
+}
+
+ThreadTrace* Profiler::AddThread()
+{
+	std::lock_guard<std::mutex> guard(threadsLock);
+
+	ThreadTrace* trace = new ThreadTrace();
+	trace->thread = threads.size();
+	trace->mainThread = (std::this_thread::get_id() == mainThread);
+	threads.push_back(trace);
+	return trace;
+}
+
+void Profiler::Clear()
+{
+	std::lock_guard<std::mutex> guard(threadsLock);
+
+	for (int i = 0; i < threads.size(); i++)
+	{
+		threads[i]->count.store(0, std::memory_order_release);
+		threads[i]->totals.clear();
+		threads[i]->lastTotal = 0;
+	}
+}
+
+bool Profiler::WriteTrace(const std::string& path)
+{
+	std::ofstream out(path);
+
+	if (!out)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard(threadsLock);
+
+	// Chrome wants microseconds.
+	out.setf(std::ios::fixed);
+	out.precision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	bool first = true;
+
+	for (int t = 0; t < threads.size(); t++)
+	{
+		ThreadTrace* trace = threads[t];
+		uint64_t count = trace->count.load(std::memory_order_acquire);
+		uint64_t begin = (count > ThreadTrace::capacity) ? count - ThreadTrace::capacity : 0;
+
+		out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << trace->thread
+			<< ",\"args\":{\"name\":\"" << (trace->mainThread ? std::string("main") : "worker " + std::to_string(trace->thread)) << "\"}}";
+		first = false;
+
+		for (uint64_t i = begin; i < count; i++)
+		{
+			const ProfileEvent& e = trace->events[i & (ThreadTrace::capacity - 1)];
+
+			out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << trace->thread
+				<< ",\"ts\":" << e.start / 1000.0 << ",\"dur\":" << (e.end - e.start) / 1000.0 << "}";
+		}
+	}
+
+	out << "\n]}\n";
+	return true;
+}
+
+void Profiler::WriteSummary(std::ostream& out)
+{
+	struct Total
+	{
+		uint64_t calls = 0;
+		double ms = 0.0;
+		double maxMs = 0.0;
+	};
+
+	// The same name can turn up on several threads (and as several pointers to the same text), so they're merged by what they say.
+	std::map<std::string, Total> totals;
+
+	{
+		std::lock_guard<std::mutex> guard(threadsLock);
+
+		for (int t = 0; t < threads.size(); t++)
+		{
+			const std::vector<ProfileTotal>& running = threads[t]->totals;
+
+			for (int i = 0; i < running.size(); i++)
+			{
+				Total& total = totals[running[i].name];
+				total.calls += running[i].calls;
+				total.ms += running[i].ns / 1000000.0;
+				total.maxMs = std::max(total.maxMs, running[i].maxNs / 1000000.0);
+			}
+		}
+	}
+
+	// The slowest things on average go first.
+	std::vector<std::pair<std::string, Total>> sorted(totals.begin(), totals.end());
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.ms / a.second.calls > b.second.ms / b.second.calls; });
+
+	out << "Profile (" + std::to_string(totals["frame"].calls) + " frames):\n";
+
+	for (int i = 0; i < sorted.size(); i++)
+	{
+		const Total& total = sorted[i].second;
+
+		out << "  " + sorted[i].first + ": " + std::to_string(total.ms / total.calls) + " ms avg, "
+			+ std::to_string(total.maxMs) + " ms max, " + std::to_string(total.calls) + " calls\n";
+	}
+}
@@ -0,0 +1,169 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// The profiler records how long things take each frame (each system's update, the particle engine, drawing, swapping buffers...)
+// so we can see where a frame actually goes. Anything worth timing just opens a ProfileScope with a name:
+//
+//     ProfileScope scope("particle engine");
+//
+// and the time from there to the end of the block is recorded as an event on the current thread.
+// Every thread writes its events into its own ring buffer, so recording never takes a lock
+// (and the oldest events are simply overwritten once the buffer's full).
+
+// The events can be written out in Chrome's trace event format (open chrome://tracing or ui.perfetto.dev and load the file),
+// and summarized per name (how many times it ran, and how long it took on average and at worst) over everything since it was last cleared;
+// the summary comes from running totals every thread keeps next to its buffer, so it still covers events the buffer has long since overwritten.
+// In the game, F9 starts and stops recording (and writes the trace when it stops), and --profile records from the start and writes it at exit.
+
+// When the profiler's off, a scope is just a check of one flag.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ProfileEvent
+{
+	// Names have to outlive the profiler (string literals, system names), since only the pointer is kept.
+	const char* name;
+
+	// Nanoseconds since the profiler was created.
+	int64_t start;
+	int64_t end;
+};
+
+// How many times one name's been recorded on one thread, and how long it took all together and at worst.
+struct ProfileTotal
+{
+	const char* name;
+	uint64_t calls;
+	int64_t ns;
+	int64_t maxNs;
+};
+
+// One thread's events. Only its own thread ever writes to it; everyone else only reads it between frames.
+class ThreadTrace
+{
+public:
+	static constexpr int capacity = 1 << 15;
+
+	int thread;
+	bool mainThread;
+	ProfileEvent events[capacity];
+
+	// How many events have ever been recorded; the last min(count, capacity) of them are still in the buffer.
+	std::atomic<uint64_t> count{ 0 };
+
+	// One per name this thread has recorded; there are only ever a few dozen names, and a thread tends to record the same ones
+	// over and over in the same order, so we look for each one starting from where the last one was.
+	std::vector<ProfileTotal> totals;
+	int lastTotal = 0;
+
+	void Record(const char* name, int64_t start, int64_t end)
+	{
+		uint64_t n = count.load(std::memory_order_relaxed);
+		events[n & (capacity - 1)] = { name, start, end };
+		count.store(n + 1, std::memory_order_release);
+
+		AddToTotal(name, end - start);
+	}
+
+	void AddToTotal(const char* name, int64_t ns)
+	{
+		int size = totals.size();
+
+		for (int i = 0; i < size; i++)
+		{
+			int index = (lastTotal + i) % size;
+			ProfileTotal& total = totals[index];
+
+			if (total.name == name)
+			{
+				total.calls++;
+				total.ns += ns;
+				total.maxNs = std::max(total.maxNs, ns);
+				lastTotal = index;
+				return;
+			}
+		}
+
+		lastTotal = size;
+		totals.push_back({ name, 1, ns, ns });
+	}
+};
+
+class Profiler
+{
+public:
+	static Profiler main;
+
+	std::atomic<bool> enabled{ false };
+
+	Profiler() : epoch(std::chrono::steady_clock::now()), mainThread(std::this_thread::get_id()) { }
+	~Profiler();
+
+	int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	// The current thread's buffer (which is made the first time a thread records anything).
+	ThreadTrace& Trace()
+	{
+		static thread_local ThreadTrace* trace = nullptr;
+
+		if (trace == nullptr)
+		{
+			trace = AddThread();
+		}
+
+		return *trace;
+	}
+
+	// Throws away everything recorded so far.
+	void Clear();
+
+	// These shouldn't be called while other threads might be recording (i.e. only between frames).
+	bool WriteTrace(const std::string& path);
+	void WriteSummary(std::ostream& out);
+
+private:
+	std::chrono::steady_clock::time_point epoch;
+	std::thread::id mainThread;
+
+	std::mutex threadsLock;
+	std::vector<ThreadTrace*> threads;
+
+	ThreadTrace* AddThread();
+};
+
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name) : name(name), start(-1)
+	{
+		if (Profiler::main.enabled.load(std::memory_order_relaxed))
+		{
+			start = Profiler::main.Now();
+		}
+	}
+
+	~ProfileScope()
+	{
+		if (start >= 0)
+		{
+			Profiler::main.Trace().Record(name, start, Profiler::main.Now());
+		}
+	}
+
+private:
+	const char* name;
+	int64_t start;
+};
+
+#endif
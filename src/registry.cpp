@@ -0,0 +1,135 @@
+// This holds the registry's name and tag indexes (see registry.h).
+
+#include "registry.h"
+
+#include <iostream>
+
+void EntityRegistry::Add(Entity* e)
+{
+	entities.Add(e);
+	NameList(e->Get_NameID()).Add(e);
+
+	uint32_t mask = e->tagMask;
+
+	for (int tag = 0; mask != 0; tag++, mask >>= 1)
+	{
+		if (mask & 1)
+		{
+			TagList(tag).Add(e);
+		}
+	}
+}
+
+void EntityRegistry::Remove(Entity* e)
+{
+	entities.Remove(e);
+	NameList(e->Get_NameID()).Remove(e);
+
+	// The slot might be handed to someone else, so the entity's tags go with it.
+	uint32_t mask = e->tagMask;
+
+	for (int tag = 0; mask != 0; tag++, mask >>= 1)
+	{
+		if (mask & 1)
+		{
+			TagList(tag).Remove(e);
+		}
+	}
+
+	e->tagMask = 0;
+}
+
+void EntityRegistry::Rename(Entity* e, int oldName, int newName)
+{
+	if (oldName != newName && IsLive(e))
+	{
+		NameList(oldName).Remove(e);
+		NameList(newName).Add(e);
+	}
+}
+
+bool EntityRegistry::Tag(Entity* e, const std::string& tag)
+{
+	int id = tags.Intern(tag);
+
+	if (id >= maxTags)
+	{
+		std::cerr << "Can't tag anything \"" + tag + "\", there are already " + std::to_string(maxTags) + " other tags\n";
+		return false;
+	}
+
+	if ((e->tagMask >> id) & 1)
+	{
+		return true;
+	}
+
+	e->tagMask |= (1u << id);
+
+	if (IsLive(e))
+	{
+		TagList(id).Add(e);
+	}
+
+	return true;
+}
+
+void EntityRegistry::Untag(Entity* e, const std::string& tag)
+{
+	int id = tags.Find(tag);
+
+	if (id == -1 || id >= maxTags || !((e->tagMask >> id) & 1))
+	{
+		return;
+	}
+
+	e->tagMask &= ~(1u << id);
+
+	if (IsLive(e))
+	{
+		TagList(id).Remove(e);
+	}
+}
+
+bool EntityRegistry::HasTag(Entity* e, const std::string& tag)
+{
+	int id = tags.Find(tag);
+	return id != -1 && id < maxTags && ((e->tagMask >> id) & 1);
+}
+
+Entity* EntityRegistry::Find(const std::string& name)
+{
+	const std::vector<Entity*>& found = FindAll(name);
+	return (found.size() > 0) ? found[0] : nullptr;
+}
+
+const std::vector<Entity*>& EntityRegistry::FindAll(const std::string& name)
+{
+	int id = names.Find(name);
+	return (id != -1) ? NameList(id).items : none;
+}
+
+const std::vector<Entity*>& EntityRegistry::Tagged(const std::string& tag)
+{
+	int id = tags.Find(tag);
+	return (id != -1 && id < maxTags) ? TagList(id).items : none;
+}
+
+EntityList& EntityRegistry::NameList(int name)
+{
+	if (name >= byName.size())
+	{
+		byName.resize(name + 1);
+	}
+
+	return byName[name];
+}
+
+EntityList& EntityRegistry::TagList(int tag)
+{
+	if (tag >= byTag.size())
+	{
+		byTag.resize(tag + 1);
+	}
+
+	return byTag[tag];
+}
@@ -0,0 +1,143 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+// The registry is how one finds entities without going through every single one of them.
+// It keeps a dense list of every live entity, plus a list of the entities with each name and each tag,
+// so e.g. ECS::main.registry.Find("Lily") or ECS::main.registry.Tagged("enemy") doesn't have to look at anything else.
+// Names and tags are interned: each distinct string is stored once and entities just hold its number,
+// so entities don't each carry their own copy of "floor" around, and nobody has to copy one to look at it.
+// Parked entities (see prefab.h) aren't live, so they're taken out of the registry until they're spawned again.
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include "entity.h"
+
+// A list of entities that can be added to and removed from in constant time.
+// Like the views, it remembers which row each entity's slot is in and fills holes with the last row,
+// so the order isn't preserved.
+class EntityList
+{
+public:
+	std::vector<Entity*> items;
+
+	void Add(Entity* e)
+	{
+		uint32_t index = e->Get_Handle().Index();
+
+		if (index >= rowOf.size())
+		{
+			rowOf.resize(index + 1, -1);
+		}
+
+		rowOf[index] = items.size();
+		items.push_back(e);
+	}
+
+	void Remove(Entity* e)
+	{
+		uint32_t index = e->Get_Handle().Index();
+		int row = rowOf[index];
+
+		Entity* last = items.back();
+		items[row] = last;
+		rowOf[last->Get_Handle().Index()] = row;
+
+		items.pop_back();
+		rowOf[index] = -1;
+	}
+
+	bool Contains(Entity* e)
+	{
+		uint32_t index = e->Get_Handle().Index();
+		return index < rowOf.size() && rowOf[index] != -1;
+	}
+
+	int size() { return items.size(); }
+	Entity* operator[](int i) { return items[i]; }
+
+private:
+	std::vector<int> rowOf;
+};
+
+// Each distinct string gets a number the first time it's seen.
+// The strings are kept in a deque, so references to them stay good no matter how many more get added.
+class StringTable
+{
+public:
+	int Intern(const std::string& s)
+	{
+		auto found = ids.find(s);
+
+		if (found != ids.end())
+		{
+			return found->second;
+		}
+
+		int id = strings.size();
+		strings.push_back(s);
+		ids[s] = id;
+		return id;
+	}
+
+	// Returns -1 if the string has never been interned (in which case nothing could have it).
+	int Find(const std::string& s) const
+	{
+		auto found = ids.find(s);
+		return (found != ids.end()) ? found->second : -1;
+	}
+
+	const std::string& Get(int id) const { return strings[id]; }
+	int size() const { return strings.size(); }
+
+private:
+	std::deque<std::string> strings;
+	std::map<std::string, int> ids;
+};
+
+class EntityRegistry
+{
+public:
+	// Every live entity.
+	EntityList entities;
+
+	StringTable names;
+
+	// Each tag gets a bit in every entity's tag mask, so there can only be 32 different tags in the whole game
+	// (not 32 per entity); once they're all taken, Tag() won't tag anything with a new one.
+	static const int maxTags = 32;
+	StringTable tags;
+
+	// These are called by the ECS hub whenever an entity is created, dies, or is parked or unparked.
+	void Add(Entity* e);
+	void Remove(Entity* e);
+
+	// Entities keep track of their own names (see Entity::Set_Name()); this just moves them to the right list.
+	void Rename(Entity* e, int oldName, int newName);
+
+	// Returns false (and complains) if the tag's new and there's no room left for it.
+	bool Tag(Entity* e, const std::string& tag);
+	void Untag(Entity* e, const std::string& tag);
+	bool HasTag(Entity* e, const std::string& tag);
+
+	// The first live entity with the given name (or nullptr if there isn't one); names aren't necessarily unique.
+	Entity* Find(const std::string& name);
+	const std::vector<Entity*>& FindAll(const std::string& name);
+	const std::vector<Entity*>& Tagged(const std::string& tag);
+
+	bool IsLive(Entity* e) { return entities.Contains(e); }
+
+private:
+	// These are indexed by the interned name (or tag).
+	std::vector<EntityList> byName;
+	std::vector<EntityList> byTag;
+
+	// What the lookups hand back for strings nobody has.
+	const std::vector<Entity*> none;
+
+	EntityList& NameList(int name);
+	EntityList& TagList(int tag);
+};
+
+#endif
@@ -8,6 +8,7 @@
 #include "check_error.h"
 #include "game.h"
 #include "component.h"
+#include "profiler.h"
 
 // This holds all the functions we use to send rendering info to OpenGL.
 // In short, one calls some variation on prepareQuad() from outside (like in ecs.cpp)
@@ -25,6 +26,8 @@ float Renderer::CalculateModifier(float i)
 
 void Renderer::CloseOffBatch()
 {
+    stats.batches++;
+
     int diff = texturesUsed.size() % MAX_TEXTURES_PER_BATCH + 1;
 
     for (int i = 0; i < diff; i++)
@@ -35,6 +38,9 @@ void Renderer::CloseOffBatch()
 
 Bundle Renderer::DetermineBatch(int textureID, int mapID)
 {
+    // Every quad comes through here exactly once.
+    stats.quads++;
+
     auto result = std::find(texturesUsed.rbegin(), texturesUsed.rend(), textureID);
     int location;
     if (result != texturesUsed.rend())
@@ -235,6 +241,13 @@ Renderer::Renderer(GLuint whiteTexture) : batches(1), shader("assets/shaders/qua
     whiteTextureIndex = 0.0f;
 }
 
+Renderer::Renderer() : batches(1), whiteTextureID(0), VAO(0), VBO(0)
+{
+    this->textureIDs.push_back(whiteTextureID);
+    this->texturesUsed.push_back(whiteTextureID);
+    whiteTextureIndex = 0.0f;
+}
+
 void Renderer::prepareQuad(glm::vec3 position, float width, float height, float scaleX, float scaleY,
     glm::vec4 rgb, int textureID, int mapID)
 {
@@ -442,6 +455,8 @@ void Renderer::prepareQuad(glm::vec2 topRight, glm::vec2 bottomRight, glm::vec2
 
 void Renderer::sendToGL()
 {
+    ProfileScope scope("sendToGL");
+
     shader.use();
     shader.setMatrix("MVP", Game::main.projection * Game::main.view);
 
@@ -452,6 +467,7 @@ void Renderer::sendToGL()
     {
         glActiveTexture(GL_TEXTURE0 + texUnit);
         glBindTexture(GL_TEXTURE_2D, textureIDs[texturesUsed[i] - 1]);
+        stats.texturesBound++;
 
         if (texUnit >= MAX_TEXTURES_PER_BATCH - 1)
         {
@@ -519,10 +535,27 @@ void Renderer::flush(const Batch& batch)
     // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIBO);
     glBufferSubData(GL_ARRAY_BUFFER, 0, batch.quadIndex * sizeof(Quad), &batch.quadBuffer[0]);
     glDrawElements(GL_TRIANGLES, batch.quadIndex * 6, GL_UNSIGNED_INT, nullptr);
+
+    stats.drawCalls++;
+}
+
+int Renderer::QuadCount() const
+{
+    int count = 0;
+
+    for (const Batch& batch : batches)
+    {
+        count += batch.quadIndex;
+    }
+
+    return count;
 }
 
 void Renderer::resetBuffers()
 {
+    lastFrame = stats;
+    stats = RenderStats();
+
     texturesUsed.clear();
     texturesUsed.push_back(whiteTextureID);
 
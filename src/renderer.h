@@ -65,6 +65,15 @@ public:
     int quadIndex = 0;
 };
 
+// What the renderer did in a frame (see the performance overlay).
+struct RenderStats
+{
+    int drawCalls = 0;
+    int batches = 1;
+    int quads = 0;
+    int texturesBound = 0;
+};
+
 // A batch renderer for quads with a color and sprite
 class Renderer
 {
@@ -83,7 +92,14 @@ public:
 
     GLuint whiteTextureID;
 
+    // The counts for the frame being prepared, and for the last one that was sent (which are the ones worth showing).
+    RenderStats stats;
+    RenderStats lastFrame;
+
     Renderer(GLuint whiteTexture);
+    // A renderer with no GL behind it, for headless runs: quads are batched up exactly the same,
+    // but sendToGL() is never called, so they're just counted and thrown away by resetBuffers().
+    Renderer();
     float CalculateModifier(float i);
     void CloseOffBatch();
     Bundle DetermineBatch(int textureID, int mapID);
@@ -99,6 +115,9 @@ public:
     void sendToGL();
     void resetBuffers();
 
+    // How many quads have been prepared since the last resetBuffers().
+    int QuadCount() const;
+
 private:
     std::vector<Batch> batches;
     Shader shader;
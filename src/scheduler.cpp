@@ -0,0 +1,309 @@
+// This holds the thread pool and the scheduler that runs the systems on it.
+
+#include "scheduler.h"
+#include "ecs.h"
+#include "system.h"
+
+#include <chrono>
+
+// Which queue belongs to the thread we're on; the main thread is always zero.
+static thread_local int currentQueue = 0;
+
+thread_local int Scheduler::running = -1;
+
+#pragma region Thread Pool
+
+void ThreadPool::Start(int workers)
+{
+	Stop();
+	stopping = false;
+
+	for (int i = 0; i <= workers; i++)
+	{
+		queues.push_back(new WorkQueue());
+	}
+
+	for (int i = 1; i <= workers; i++)
+	{
+		threads.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+	}
+}
+
+void ThreadPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (int i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+	threads.clear();
+
+	for (int i = 0; i < queues.size(); i++)
+	{
+		delete queues[i];
+	}
+	queues.clear();
+}
+
+ThreadPool::~ThreadPool()
+{
+	Stop();
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	{
+		WorkQueue* q = queues[currentQueue];
+		std::lock_guard<std::mutex> guard(q->lock);
+		q->tasks.push_back(std::move(task));
+	}
+
+	queued++;
+
+	// Taking the lock here (even though we don't touch anything under it) makes sure
+	// a worker can't check for work and then go to sleep right after we've added some.
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+	}
+	wake.notify_one();
+}
+
+bool ThreadPool::Pop(int queue, std::function<void()>& task)
+{
+	WorkQueue* q = queues[queue];
+	std::lock_guard<std::mutex> guard(q->lock);
+
+	if (q->tasks.empty())
+	{
+		return false;
+	}
+
+	task = std::move(q->tasks.back());
+	q->tasks.pop_back();
+	return true;
+}
+
+bool ThreadPool::Steal(int thief, std::function<void()>& task)
+{
+	// We start looking just past our own queue so that every thread doesn't go after the same victim.
+	for (int i = 1; i < queues.size(); i++)
+	{
+		WorkQueue* q = queues[(thief + i) % queues.size()];
+		std::lock_guard<std::mutex> guard(q->lock);
+
+		if (!q->tasks.empty())
+		{
+			task = std::move(q->tasks.front());
+			q->tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ThreadPool::RunOne()
+{
+	if (queues.size() == 0)
+	{
+		return false;
+	}
+
+	std::function<void()> task;
+
+	if (Pop(currentQueue, task) || Steal(currentQueue, task))
+	{
+		queued--;
+		task();
+		return true;
+	}
+
+	return false;
+}
+
+void ThreadPool::WorkerLoop(int queue)
+{
+	currentQueue = queue;
+
+	while (!stopping)
+	{
+		if (!RunOne())
+		{
+			std::unique_lock<std::mutex> sleep(sleepLock);
+			wake.wait(sleep, [this] { return queued > 0 || stopping; });
+		}
+	}
+}
+
+#pragma endregion
+
+#pragma region Scheduler
+
+bool Scheduler::Conflicts(System* a, System* b)
+{
+	if (a->exclusive || b->exclusive)
+	{
+		return true;
+	}
+
+	return (a->writes & (b->reads | b->writes)) != 0 || (b->writes & a->reads) != 0;
+}
+
+void Scheduler::Build(std::vector<ComponentBlock*>& blocks, int workers)
+{
+	nodes.clear();
+
+	for (int i = 0; i < blocks.size(); i++)
+	{
+		Node n;
+		n.block = blocks[i];
+		nodes.push_back(n);
+	}
+
+	phases[0].clear();
+	phases[1].clear();
+
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		phases[nodes[i].block->system->render ? 1 : 0].push_back(i);
+	}
+
+	// Whenever two systems in the same phase conflict, the one that was added first goes first.
+	for (int j = 0; j < nodes.size(); j++)
+	{
+		for (int i = 0; i < j; i++)
+		{
+			bool samePhase = nodes[i].block->system->render == nodes[j].block->system->render;
+
+			if (samePhase && Conflicts(nodes[i].block->system, nodes[j].block->system))
+			{
+				nodes[i].dependents.push_back(j);
+				nodes[j].dependencies++;
+			}
+		}
+	}
+
+	waiting = std::vector<std::atomic<int>>(nodes.size());
+
+	pool.Start(workers);
+}
+
+void Scheduler::Run(int activeScene, float deltaTime, bool render)
+{
+	this->activeScene = activeScene;
+	this->deltaTime = deltaTime;
+
+	std::vector<int>& phase = phases[render ? 1 : 0];
+
+	busy = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	if (!parallel || pool.Workers() == 0)
+	{
+		for (int i = 0; i < phase.size(); i++)
+		{
+			Execute(phase[i]);
+		}
+	}
+	else
+	{
+		remaining = phase.size();
+
+		for (int i = 0; i < phase.size(); i++)
+		{
+			waiting[phase[i]] = nodes[phase[i]].dependencies;
+		}
+
+		for (int i = 0; i < phase.size(); i++)
+		{
+			if (nodes[phase[i]].dependencies == 0)
+			{
+				Launch(phase[i]);
+			}
+		}
+
+		// The main thread runs anything that has to be on the main thread and helps out with everything else.
+		while (remaining > 0)
+		{
+			if (!RunMainTask() && !pool.RunOne())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	auto end = std::chrono::steady_clock::now();
+
+	stats.threads = (parallel) ? pool.Workers() + 1 : 1;
+	stats.frameMs = std::chrono::duration<float, std::milli>(end - start).count();
+	stats.busyMs = busy / 1000000.0f;
+	stats.utilization = (stats.frameMs > 0.0f) ? stats.busyMs / (stats.frameMs * stats.threads) : 0.0f;
+}
+
+void Scheduler::Launch(int node)
+{
+	if (nodes[node].block->system->mainThread)
+	{
+		std::lock_guard<std::mutex> guard(mainLock);
+		mainTasks.push_back(node);
+	}
+	else
+	{
+		pool.Submit([this, node] { Execute(node); });
+	}
+}
+
+bool Scheduler::RunMainTask()
+{
+	int node;
+
+	{
+		std::lock_guard<std::mutex> guard(mainLock);
+
+		if (mainTasks.empty())
+		{
+			return false;
+		}
+
+		node = mainTasks.front();
+		mainTasks.pop_front();
+	}
+
+	Execute(node);
+	return true;
+}
+
+void Scheduler::Execute(int node)
+{
+	auto start = std::chrono::steady_clock::now();
+	int previous = running;
+	running = node;
+	nodes[node].block->Update(activeScene, deltaTime);
+	running = previous;
+	auto end = std::chrono::steady_clock::now();
+
+	nodes[node].block->system->lastMs = std::chrono::duration<float, std::milli>(end - start).count();
+	busy += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+	if (parallel && pool.Workers() > 0)
+	{
+		for (int i = 0; i < nodes[node].dependents.size(); i++)
+		{
+			int d = nodes[node].dependents[i];
+
+			if (--waiting[d] == 0)
+			{
+				Launch(d);
+			}
+		}
+
+		remaining--;
+	}
+}
+
+#pragma endregion
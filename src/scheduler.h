@@ -0,0 +1,184 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+// The scheduler is what actually runs the systems every frame.
+// Each system declares which component types (and which other bits of shared state, like the camera or the particle engine)
+// it reads and writes; from those, the scheduler works out which systems have to wait on which.
+// Two systems only have to run in order if one of them writes something the other touches; in that case,
+// they run in the order they were created in ECS::Init(), just like they always did.
+// Everything else is free to run at the same time on the thread pool below.
+
+// Systems are split into two phases: the simulation, which runs on a fixed step (possibly several times a frame),
+// and rendering, which runs once a frame. Run() only runs one phase at a time, and systems only wait on systems in the same phase.
+
+// The thread pool is a simple work-stealing pool: each thread has its own queue of tasks,
+// takes work from the back of its own queue, and, when that runs dry, steals from the front of somebody else's.
+// The main thread owns the first queue and pitches in while it waits for the frame to finish.
+
+// Systems can also split their own loops up across the pool with ParallelFor(), which hands out
+// fixed-size chunks of the range (sized so each one fits comfortably in cache) and waits for all of them;
+// the thread that's waiting runs chunks too, so it's fine to call it from a system that's already running on a worker.
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+class System;
+class ComponentBlock;
+
+class ThreadPool
+{
+public:
+	void Start(int workers);
+	void Stop();
+
+	void Submit(std::function<void()> task);
+
+	// Runs one task if there's any to be had; returns false if every queue was empty.
+	bool RunOne();
+
+	// The number of worker threads (not counting the main thread).
+	int Workers() { return threads.size(); }
+
+	~ThreadPool();
+
+private:
+	struct WorkQueue
+	{
+		std::mutex lock;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<WorkQueue*> queues;
+	std::vector<std::thread> threads;
+
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::atomic<int> queued{ 0 };
+	std::atomic<bool> stopping{ false };
+
+	bool Pop(int queue, std::function<void()>& task);
+	bool Steal(int thief, std::function<void()>& task);
+	void WorkerLoop(int queue);
+};
+
+struct SchedulerStats
+{
+	// How long the last frame's systems took from start to finish.
+	float frameMs = 0.0f;
+
+	// How long was spent inside systems, summed over every thread.
+	float busyMs = 0.0f;
+
+	// How much of the available thread time was actually spent running systems (between zero and one).
+	float utilization = 0.0f;
+
+	int threads = 1;
+};
+
+class Scheduler
+{
+public:
+	ThreadPool pool;
+	SchedulerStats stats;
+
+	// When this is off (or there are no workers), the systems just run one after another in their usual order.
+	bool parallel = true;
+
+	// In deterministic mode, ParallelFor runs every chunk in order on the calling thread.
+	// Nothing we split up should care about the order its chunks run in, but this is handy for replays
+	// (and for ruling out threading when something goes wrong).
+	bool deterministic = false;
+
+	// Ranges smaller than this aren't worth the trouble of handing out to other threads.
+	int serialThreshold = 2048;
+
+	// The index of the system the current thread is running (or -1 if it isn't running one).
+	// Command buffers use this to put what they record back in system order.
+	static thread_local int running;
+
+	// Calls body(begin, end) over [0, count) in chunks of chunkSize.
+	template <typename F>
+	void ParallelFor(int count, int chunkSize, F body)
+	{
+		if (deterministic || !parallel || count < serialThreshold || pool.Workers() == 0)
+		{
+			for (int begin = 0; begin < count; begin += chunkSize)
+			{
+				body(begin, std::min(begin + chunkSize, count));
+			}
+
+			return;
+		}
+
+		std::atomic<int> left{ (count + chunkSize - 1) / chunkSize };
+		int node = running;
+
+		for (int begin = 0; begin < count; begin += chunkSize)
+		{
+			int end = std::min(begin + chunkSize, count);
+
+			pool.Submit([&body, &left, node, begin, end]
+				{
+					int previous = running;
+					running = node;
+					body(begin, end);
+					running = previous;
+					left--;
+				});
+		}
+
+		while (left > 0)
+		{
+			if (!pool.RunOne())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// Builds the dependency graph from the systems' declarations and starts the workers.
+	void Build(std::vector<ComponentBlock*>& blocks, int workers);
+
+	// Runs either the simulation systems or the rendering systems.
+	void Run(int activeScene, float deltaTime, bool render);
+
+	static bool Conflicts(System* a, System* b);
+
+private:
+	struct Node
+	{
+		ComponentBlock* block;
+		std::vector<int> dependents;
+		int dependencies = 0;
+	};
+
+	std::vector<Node> nodes;
+
+	// The nodes in each phase (simulation first, then rendering).
+	std::vector<int> phases[2];
+
+	// How many of each node's dependencies haven't finished yet this frame.
+	std::vector<std::atomic<int>> waiting;
+	std::atomic<int> remaining{ 0 };
+	std::atomic<int64_t> busy{ 0 };
+
+	// Systems that have to run on the main thread wait in here rather than in the pool.
+	std::mutex mainLock;
+	std::deque<int> mainTasks;
+
+	int activeScene = 0;
+	float deltaTime = 0.0f;
+
+	void Launch(int node);
+	void Execute(int node);
+	bool RunMainTask();
+};
+
+#endif
@@ -19,6 +19,8 @@ public:
 
     // Constructor reads and builds the shader
     Shader(const char* vertexPath, const char* fragmentPath);
+    // An empty shader, for when there's no GL context to build one in (see Renderer()).
+    Shader() : ID(0) { }
     // Use/activate the shader
     void use();
     // Utility uniform functions
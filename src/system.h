@@ -8,8 +8,14 @@
 // like the collision struct used by the collision system.
 
 #include "game.h"
+#include "broadphase.h"
+#include "narrowphase.h"
+#include "component.h"
+#include "entity.h"
 #include <vector>
 #include <array>
+#include <cstdint>
+#include <initializer_list>
 #include "glm/gtx/norm.hpp"
 
 using namespace std;
@@ -47,6 +53,20 @@ struct Collision
 
 	ColliderComponent* colB;
 
+	// This is the relative velocity the contact was found with; if resolving an earlier contact
+	// doesn't change it, there's no reason to run the narrowphase on this pair a second time.
+	glm::vec2 relVel;
+
+	Collision()
+	{
+		this->contactPoint = glm::vec2(0, 0);
+		this->contactNormal = glm::vec2(0, 0);
+		this->time = 0.0f;
+		this->colB = nullptr;
+		this->resolve = false;
+		this->relVel = glm::vec2(0, 0);
+	}
+
 	Collision(glm::vec2 contactPoint, glm::vec2 contactNormal, float time, ColliderComponent* colB, bool resolve)
 	{
 		this->contactPoint = contactPoint;
@@ -54,12 +74,57 @@ struct Collision
 		this->time = time;
 		this->colB = colB;
 		this->resolve = resolve;
+		this->relVel = glm::vec2(0, 0);
 	}
 };
 
+enum class TriggerEventType { enter, stay, exit };
+
+// Triggers report what they overlap as events rather than contacts (see ColliderSystem::TriggerEvents()).
+// These hold handles, since whatever a trigger stopped overlapping might not be around anymore.
+struct TriggerEvent
+{
+	EntityHandle trigger;
+	EntityHandle other;
+	TriggerEventType type;
+};
+
+// Anything a system touches that isn't a component gets a bit of its own (after the component IDs)
+// so that the scheduler can treat it just like a component when it's working out what can run alongside what.
+constexpr int cameraResourceID = maxComponentIDs;			// Game::main's camera.
+constexpr int particleResourceID = maxComponentIDs + 1;		// ParticleEngine::main.
+constexpr int randomResourceID = maxComponentIDs + 2;		// rand(); systems that call it stay in order so runs are repeatable.
+constexpr int renderResourceID = maxComponentIDs + 3;		// The renderer's batches and the text renderer.
+constexpr int windowResourceID = maxComponentIDs + 4;		// GLFW's input state (and Game::main's input flags).
+
 class System
 {
 public:
+	// The component types (and resources) this system reads and writes during its update, as bits.
+	uint64_t reads = 0;
+	uint64_t writes = 0;
+
+	// Systems that talk to GLFW or OpenGL have to run on the main thread.
+	bool mainThread = false;
+
+	// Systems that change entities directly in the middle of their update (rather than through a command buffer)
+	// can't run alongside anything else.
+	bool exclusive = false;
+
+	// Systems that only draw things (or lay them out to be drawn) run once per rendered frame, after the simulation;
+	// everything else runs on the simulation's fixed step, however many times a frame that happens to be (see ECS::Update()).
+	bool render = false;
+
+	// The frame this system last ran in (see Component::ChangedSince()); zero until it's run once.
+	uint32_t lastRun = 0;
+
+	// What the system's called in reports (like the benchmark's), and how long its last update took.
+	const char* name = "";
+	float lastMs = 0.0f;
+
+	void Reads(std::initializer_list<int> ids) { for (int id : ids) reads |= (uint64_t)1 << id; }
+	void Writes(std::initializer_list<int> ids) { for (int id : ids) writes |= (uint64_t)1 << id; }
+
 	virtual void Update(int activeScene, float deltaTime) = 0;
 	virtual void AddComponent(Component* component) = 0;
 	virtual void PurgeEntity(Entity* e) = 0;
@@ -68,7 +133,13 @@ public:
 class StaticRenderingSystem : public System
 {
 public:
-	vector<StaticSpriteComponent*> sprites;
+	ComponentList<StaticSpriteComponent> sprites;
+
+	// The sprites in the global and active scenes, sorted back to front.
+	// This is only gathered again when sprites come or go (or the scene changes).
+	vector<StaticSpriteComponent*> drawList;
+	uint32_t drawListVersion = 0;
+	int drawListScene = -1;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -80,7 +151,10 @@ public:
 class PhysicsSystem : public System
 {
 public:
-	vector<PhysicsComponent*> phys;
+	ComponentList<PhysicsComponent> phys;
+
+	// How many bodies each thread takes at a time.
+	static const int chunkSize = 512;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -92,7 +166,10 @@ public:
 class PositionSystem : public System
 {
 public:
-	vector<PositionComponent*> pos;
+	ComponentList<PositionComponent> pos;
+
+	// How many of the body stream's chunks each thread takes at a time.
+	static const int chunksPerTask = 4;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -103,19 +180,59 @@ public:
 
 class ColliderSystem : public System
 {
-	vector<ColliderComponent*> colls;
+	ComponentList<ColliderComponent> colls;
+
+	// Each scene gets its own broadphase, so colliders in inactive scenes never show up as candidates.
+	vector<Broadphase*> broadphases;
+	vector<ColliderComponent*> candidates;
+
+	// The contacts found this frame. This gets cleared at the start of every update
+	// but keeps its capacity, so after the first few frames we don't allocate anything for them.
+	vector<Collision> contacts;
+
+	// The narrowphase's batch for the collider being resolved, and which collider (and relative velocity) each pair in it was for.
+	SweptPairs sweeps;
+	vector<std::pair<ColliderComponent*, glm::vec2>> swept;
+
+	// Every trigger's overlaps this frame, keyed by the two entities' IDs so they can be sorted and compared with last frame's.
+	struct TriggerContact
+	{
+		uint64_t key;
+		ColliderComponent* trigger;
+		ColliderComponent* other;
+	};
+
+	vector<TriggerContact> triggerContacts;
+	vector<uint64_t> lastTriggerKeys;
+	vector<TriggerEvent> triggerEvents;
+	vector<ColliderPair> entered;
 
 	void Update(int activeScene, float deltaTime);
 
+	// Fills candidates with whatever the collider's box overlaps (and it interacts with) in the global scene and the active one.
+	void FindCandidates(ColliderComponent* c, int activeScene);
+
+	// The trigger pass: triggers and damage volumes only overlap things, so they're kept out of the swept narrowphase
+	// and the resolve loop entirely, and handled here after the solid colliders are done.
+	void UpdateTriggers(int activeScene, float deltaTime);
+
+	void ApplyDamage(ColliderComponent* source, ColliderComponent* target, float deltaTime);
+
+	AABB SweptBox(ColliderComponent* col, PhysicsComponent* phys, float deltaTime);
+
+	Broadphase& SceneBroadphase(int scene);
+
+	void UpdateBroadphase(int activeScene, float deltaTime);
+
 	bool RaycastDown(float size, float distance, ColliderComponent* colA, PositionComponent* posA, ColliderComponent* colB, PositionComponent* posB);
 
 	bool TestCollision(ColliderComponent* colA, PositionComponent* posA, PhysicsComponent* physA, ColliderComponent* colB, PositionComponent* posB, PhysicsComponent* physB, float deltaTime);
 
 	bool TestAndResolveCollision(ColliderComponent* colA, PositionComponent* posA, PhysicsComponent* physA, ColliderComponent* colB, PositionComponent* posB, PhysicsComponent* physB, float deltaTime);
 
-	Collision* ArbitraryRectangleCollision(ColliderComponent* colA, PositionComponent* posA, PhysicsComponent* physA, ColliderComponent* colB, PositionComponent* posB, PhysicsComponent* physB, float deltaTime);
+	bool ArbitraryRectangleCollision(ColliderComponent* colA, PositionComponent* posA, PhysicsComponent* physA, ColliderComponent* colB, PositionComponent* posB, PhysicsComponent* physB, float deltaTime, Collision& out);
 
-	Collision* DynamicArbitraryRectangleCollision(ColliderComponent* colA, PositionComponent* posA, PhysicsComponent* physA, ColliderComponent* colB, PositionComponent* posB, PhysicsComponent* physB, float deltaTime);
+	bool DynamicArbitraryRectangleCollision(ColliderComponent* colA, PositionComponent* posA, PhysicsComponent* physA, ColliderComponent* colB, PositionComponent* posB, PhysicsComponent* physB, float deltaTime, Collision& out);
 
 	float Dot(glm::vec2 a, glm::vec2 b);
 
@@ -126,12 +243,30 @@ class ColliderSystem : public System
 	void AddComponent(Component* component);
 
 	void PurgeEntity(Entity* e);
+
+public:
+	// Takes a collider out of its broadphase without getting rid of it (for parked entities; see prefab.h).
+	void DropProxy(ColliderComponent* c);
+
+	// Swaps the scene's broadphase for a different kind (every scene starts out with a grid).
+	// Its colliders are all put back in on the next update.
+	void SetBroadphase(int scene, BroadphaseType type);
+
+	// These are for gameplay code, and look at the global scene and the active one, just like the collider system does.
+	// Only active colliders with physics components on one of the given layers are found, and only where they actually are (not where they're going).
+	void QueryRegion(int activeScene, const AABB& box, vector<ColliderComponent*>& out, uint32_t layers = allLayers);
+
+	// Every trigger that started overlapping something, is still overlapping it, or just stopped during the last update.
+	const vector<TriggerEvent>& TriggerEvents() { return triggerEvents; }
+
+	// The hits come back nearest first.
+	void Raycast(int activeScene, float fromX, float fromY, float toX, float toY, vector<RayHit>& out, uint32_t layers = allLayers);
 };
 
 class InputSystem : public System
 {
 public:
-	vector<InputComponent*> move;
+	ComponentList<InputComponent> move;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -143,7 +278,7 @@ public:
 class CameraFollowSystem : public System
 {
 public:
-	vector<CameraFollowComponent*> folls;
+	ComponentList<CameraFollowComponent> folls;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -157,7 +292,7 @@ public:
 class AnimationControllerSystem : public System
 {
 public:
-	vector<AnimationControllerComponent*> controllers;
+	ComponentList<AnimationControllerComponent> controllers;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -169,10 +304,19 @@ public:
 class AnimationSystem : public System
 {
 public:
-	vector<AnimationComponent*> anims;
+	ComponentList<AnimationComponent> anims;
+
+	// The animations in the global and active scenes, sorted back to front.
+	vector<AnimationComponent*> drawList;
+
+	// How many animations each thread takes at a time.
+	static const int chunkSize = 512;
 
 	void Update(int activeScene, float deltaTime);
 
+	// Moves an animation along to its next frame (if it's time).
+	void Advance(AnimationComponent* a, float deltaTime);
+
 	void AddComponent(Component* component);
 
 	void PurgeEntity(Entity* e);
@@ -181,7 +325,7 @@ public:
 class HealthSystem : public System
 {
 public:
-	vector<HealthComponent*> healths;
+	ComponentList<HealthComponent> healths;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -193,7 +337,7 @@ public:
 class ParticleSystem : public System
 {
 public:
-	vector<ParticleComponent*> particles;
+	ComponentList<ParticleComponent> particles;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -205,7 +349,7 @@ public:
 class DamageSystem : public System
 {
 public:
-	vector<DamageComponent*> damagers;
+	ComponentList<DamageComponent> damagers;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -217,7 +361,10 @@ public:
 class AISystem : public System
 {
 public:
-	vector<AIComponent*> ai;
+	ComponentList<AIComponent> ai;
+
+	// What the last line of sight check ran into (kept around so it doesn't allocate every time).
+	vector<RayHit> sightHits;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -229,7 +376,7 @@ public:
 class BladeSystem : public System
 {
 public:
-	vector<BladeComponent*> blades;
+	ComponentList<BladeComponent> blades;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -241,7 +388,11 @@ public:
 class ImageSystem : public System
 {
 public:
-	vector<ImageComponent*> images;
+	ComponentList<ImageComponent> images;
+
+	// Images are laid out relative to the camera, so they only need to be laid out again when it moves or zooms (or they change).
+	glm::vec4 lastView = glm::vec4(0.0f);
+	float lastZoom = 0.0f;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -253,13 +404,19 @@ public:
 class ButtonSystem : public System
 {
 public:
-	vector<ButtonComponent*> buttons;
+	ComponentList<ButtonComponent> buttons;
+
+	// The buttons in the global and active scenes, sorted front to back.
+	vector<ButtonComponent*> sorted;
 
 	void Update(int activeScene, float deltaTime);
 
 	bool CheckButtonReqs(ButtonComponent* b);
 	void ToggleExclusiveButtons(ButtonComponent* b, bool click);
 
+	// Looks up the button belonging to the given entity (or returns nullptr if it's gone).
+	static ButtonComponent* GetButton(EntityHandle handle);
+
 	void AddComponent(Component* component);
 
 	void PurgeEntity(Entity* e);
@@ -268,7 +425,7 @@ public:
 class TextRenderingSystem : public System
 {
 public:
-	vector<TextComponent*> texts;
+	ComponentList<TextComponent> texts;
 
 	void Update(int activeScene, float deltaTime);
 
@@ -8,10 +8,31 @@
 #include <iostream>
 #include <climits>
 
+bool Texture2D::headless = false;
+
+GLuint Texture2D::NextHeadlessID()
+{
+    static GLuint next = 1;
+    return next++;
+}
+
 Texture2D::Texture2D(const char* file, bool alpha, int filter)
     : width(0), height(0), internalFormat(GL_RGB), imageFormat(GL_RGB), wrapS(GL_REPEAT),
     wrapT(GL_REPEAT), filterMin(filter), filterMax(filter)
 {
+    if (headless)
+    {
+        int imageWidth;
+        int imageHeight;
+        int nrChannels;
+        stbi_info(file, &imageWidth, &imageHeight, &nrChannels);
+
+        this->ID = NextHeadlessID();
+        this->width = imageWidth;
+        this->height = imageHeight;
+        return;
+    }
+
     glGenTextures(1, &this->ID);
 
     if (alpha)
@@ -50,6 +71,12 @@ Texture2D::Texture2D()
     : width(1), height(1), internalFormat(GL_RGB), imageFormat(GL_RGB), wrapS(GL_REPEAT),
     wrapT(GL_REPEAT), filterMin(GL_LINEAR), filterMax(GL_LINEAR)
 {
+    if (headless)
+    {
+        this->ID = NextHeadlessID();
+        return;
+    }
+
     glGenTextures(1, &this->ID);
 
     constexpr unsigned char data[] = { UCHAR_MAX, UCHAR_MAX, UCHAR_MAX };
@@ -16,6 +16,11 @@ private:
 public:
     static Texture2D* whiteTexture();
 
+    // In headless mode there's no GL context to upload anything to, so textures just read their size
+    // (which the game needs for things like colliders) and make up an ID (which the renderer still needs to batch them).
+    static bool headless;
+    static GLuint NextHeadlessID();
+
     GLuint       ID;
     unsigned int width;
     unsigned int height;
@@ -0,0 +1,98 @@
+#ifndef VIEW_H
+#define VIEW_H
+
+// A view is a cached list of every entity that has a certain set of components, along with pointers to those components.
+// Rather than having a system loop over its own components and then go looking for the other components it needs
+// on each one's entity (and then check that they're actually there), it can just ask the ECS hub for a view,
+// e.g. ECS::main.View<ColliderComponent, PhysicsComponent>(), and loop over that.
+// Views are kept up to date as components are registered and entities are deleted, so asking for one
+// is free after the first time; they never have to be rebuilt from scratch.
+
+#include <vector>
+#include <tuple>
+#include "entity.h"
+#include "componentpool.h"
+
+class ViewBase
+{
+public:
+	// The bits of the component IDs an entity needs to be in the view.
+	uint32_t mask = 0;
+
+	virtual void Add(Entity* e) = 0;
+	virtual void Remove(Entity* e) = 0;
+};
+
+template <typename... Ts>
+class ComponentView : public ViewBase
+{
+public:
+	// Each row holds one entity's components, in the order they were asked for.
+	// Like the component lists, rows are partitioned by scene (see componentpool.h).
+	std::vector<std::vector<std::tuple<Ts*...>>> rows;
+	std::vector<std::vector<Entity*>> entities;
+
+	ComponentView() : rows(1), entities(1)
+	{
+		mask = ((1u << ComponentId<Ts>()) | ...);
+	}
+
+	void Add(Entity* e)
+	{
+		uint32_t index = e->Get_Handle().Index();
+		int scene = e->Get_Scene();
+
+		if (index >= rowOf.size())
+		{
+			rowOf.resize(index + 1, -1);
+			sceneOf.resize(index + 1, 0);
+		}
+
+		if (scene >= rows.size())
+		{
+			rows.resize(scene + 1);
+			entities.resize(scene + 1);
+		}
+
+		rowOf[index] = rows[scene].size();
+		sceneOf[index] = scene;
+		rows[scene].push_back(std::tuple<Ts*...>(e->Get<Ts>()...));
+		entities[scene].push_back(e);
+	}
+
+	void Remove(Entity* e)
+	{
+		uint32_t index = e->Get_Handle().Index();
+		int row = rowOf[index];
+		int scene = sceneOf[index];
+
+		// Just like the component lists, we fill the hole with the last row.
+		Entity* last = entities[scene].back();
+		rows[scene][row] = rows[scene].back();
+		entities[scene][row] = last;
+		rowOf[last->Get_Handle().Index()] = row;
+
+		rows[scene].pop_back();
+		entities[scene].pop_back();
+		rowOf[index] = -1;
+	}
+
+	// The rows in the global scene and the given one.
+	PartitionRange<std::tuple<Ts*...>> Active(int activeScene)
+	{
+		if (activeScene >= rows.size())
+		{
+			rows.resize(activeScene + 1);
+			entities.resize(activeScene + 1);
+		}
+
+		return PartitionRange<std::tuple<Ts*...>>(&rows, activeScene);
+	}
+
+private:
+	// These map an entity's slot to its row (or -1 if it isn't in the view) and the scene it was filed under.
+	std::vector<int> rowOf;
+	std::vector<int> sceneOf;
+};
+
+#endif